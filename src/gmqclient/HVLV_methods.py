@@ -24,6 +24,22 @@ class HVLVDevice(HWClientInstance):
     def set_hv_control_mv(self, target: float):
         return self._wrap_method(target)
 
+    @add_serverclass_doc(HVLV_methods.HVLVDevice)
+    def ramp_hv_control_mv(self, target: float, duration: float = 1.0):
+        return self._wrap_method(target, duration)
+
+    @add_serverclass_doc(HVLV_methods.HVLVDevice)
+    def regulate_hv_mv(self, target: float, slew: float = 10000):
+        return self._wrap_method(target, slew)
+
+    @add_serverclass_doc(HVLV_methods.HVLVDevice)
+    def stop_hv_regulation(self):
+        return self._wrap_method()
+
+    @add_serverclass_doc(HVLV_methods.HVLVDevice)
+    def get_hv_regulation_status(self) -> Dict[str, Any]:
+        return self._wrap_method()
+
     @add_serverclass_doc(HVLV_methods.HVLVDevice)
     def set_lv_mv(self, target: float):
         return self._wrap_method(target)
@@ -47,3 +63,11 @@ class HVLVDevice(HWClientInstance):
     @add_serverclass_doc(HVLV_methods.HVLVDevice)
     def get_vdd_mv(self) -> float:
         return self._wrap_method()
+
+    @add_serverclass_doc(HVLV_methods.HVLVDevice)
+    def get_adc_summary(self, channel: int, window: int = 0) -> Dict[str, float]:
+        return self._wrap_method(channel, window)
+
+    @add_serverclass_doc(HVLV_methods.HVLVDevice)
+    def get_adc_telemetry(self) -> Dict[str, float]:
+        return self._wrap_method()
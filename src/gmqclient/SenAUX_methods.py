@@ -41,7 +41,33 @@ class SenAUXDevice(HWClientInstance):
         assert n <= 10_000, "Do not set pulse count larger than 10K"
         return self._wrap_method(n, w)
 
+    @add_serverclass_doc(SenAUXServer)
+    def pulse_f12(self, n: int, w: int):
+        """Adding hard count limit to avoid client/serve desync"""
+        assert n <= 10_000, "Do not set pulse count larger than 10K"
+        return self._wrap_method(n, w)
+
+    @add_serverclass_doc(SenAUXServer)
+    def pulse_f1_async(self, n: int, w: int):
+        return self._wrap_method(n, w)
+
+    @add_serverclass_doc(SenAUXServer)
+    def pulse_f2_async(self, n: int, w: int):
+        return self._wrap_method(n, w)
+
+    @add_serverclass_doc(SenAUXServer)
+    def pulse_f12_async(self, n: int, w: int):
+        return self._wrap_method(n, w)
+
+    @add_serverclass_doc(SenAUXServer)
+    def pulse_cancel(self) -> int:
+        return self._wrap_method()
+
     # Thinly wrapped Telemetry methods
+    @add_serverclass_doc(SenAUXServer)
+    def pulse_status(self) -> Dict[str, Any]:
+        return self._wrap_method()
+
     @add_serverclass_doc(SenAUXServer)
     def status_pd1(self) -> bool:
         return self._wrap_method()
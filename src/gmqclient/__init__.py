@@ -1,7 +1,12 @@
 import logging
 
 # This must be loaded first
-from .zmq_client import HWControlClient, make_zmq_client_socket
+from .zmq_client import (
+    HWAsyncControlClient,
+    HWControlClient,
+    make_zmq_async_client_socket,
+    make_zmq_client_socket,
+)
 
 # Loading all the various methods
 from . import version
@@ -16,25 +21,18 @@ from .SenAUX_methods import SenAUXDevice
 __version__ = version.__version__
 
 
-class GMQClient(HWControlClient):
-    """Default client that spawns on of each defined interface"""
+def _default_hw_list():
+    return [
+        CameraDevice("camera"),
+        DRSDevice("drs"),
+        GCoderDevice("gcoder"),
+        HVLVDevice("hvlv"),
+        SenAUXDevice("senaux"),
+    ]
 
-    def __init__(
-        self,
-        host: str = "localhost",
-        port: int = 8989,
-    ):
-        super().__init__(
-            socket=make_zmq_client_socket(host, port),
-            logger=logging.Logger("gmqclient"),
-            hw_list=[
-                CameraDevice("camera"),
-                DRSDevice("drs"),
-                GCoderDevice("gcoder"),
-                HVLVDevice("hvlv"),
-                SenAUXDevice("senaux"),
-            ],
-        )
+
+class _GMQDevices(object):
+    """Aliases for the hardware clients of the default hardware list"""
 
     # Adding aliases to the various hardware clients. Using this syntax as
     # it is nicer for static python analyzer for editors
@@ -57,3 +55,36 @@ class GMQClient(HWControlClient):
     @property
     def senaux(self) -> SenAUXDevice:
         return self.hw_list[4]
+
+
+class GMQClient(_GMQDevices, HWControlClient):
+    """Default client that spawns on of each defined interface"""
+
+    def __init__(
+        self,
+        host: str = "localhost",
+        port: int = 8989,
+    ):
+        super().__init__(
+            socket=make_zmq_client_socket(host, port),
+            logger=logging.Logger("gmqclient"),
+            hw_list=_default_hw_list(),
+        )
+
+
+class GMQAsyncClient(_GMQDevices, HWAsyncControlClient):
+    """
+    Asynchronous version of the default client, methods of the hardware
+    clients return coroutines to be awaited.
+    """
+
+    def __init__(
+        self,
+        host: str = "localhost",
+        port: int = 8989,
+    ):
+        super().__init__(
+            socket=make_zmq_async_client_socket(host, port),
+            logger=logging.Logger("gmqclient"),
+            hw_list=_default_hw_list(),
+        )
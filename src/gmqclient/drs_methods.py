@@ -1,4 +1,4 @@
-from typing import Any, Dict
+from typing import Any, Dict, List, Tuple
 
 import numpy
 
@@ -35,6 +35,34 @@ class DRSDevice(HWClientInstance):
     def force_stop(self):
         return self._wrap_method()
 
+    @add_serverclass_doc(drs_methods.DRSDevice)
+    def collect_events(
+        self, n: int, channels: List[int], timeout: int = 0
+    ) -> numpy.ndarray:
+        return self._wrap_method(n, channels, timeout)
+
+    @add_serverclass_doc(drs_methods.DRSDevice)
+    def collect_waveformsums(
+        self,
+        n: int,
+        channels: List[int],
+        windows: List[Tuple[int, int, int, int]],
+        timeout: int = 0,
+    ) -> numpy.ndarray:
+        return self._wrap_method(n, channels, windows, timeout)
+
+    @add_serverclass_doc(drs_methods.DRSDevice)
+    def start_continuous(self, channels: List[int], capacity: int = 1024):
+        return self._wrap_method(channels, capacity)
+
+    @add_serverclass_doc(drs_methods.DRSDevice)
+    def stop_continuous(self):
+        return self._wrap_method()
+
+    @add_serverclass_doc(drs_methods.DRSDevice)
+    def drain_events(self, max_events: int, timeout: int = 100000) -> numpy.ndarray:
+        return self._wrap_method(max_events, timeout)
+
     def _run_calibration(self):
         """
         Running the underlying calibration, which assumes all hardware has been
@@ -79,3 +107,7 @@ class DRSDevice(HWClientInstance):
     @add_serverclass_doc(drs_methods.DRSDevice)
     def is_ready(self) -> bool:
         return self._wrap_method()
+
+    @add_serverclass_doc(drs_methods.DRSDevice)
+    def get_continuous_status(self) -> Dict[str, int]:
+        return self._wrap_method()
@@ -1,7 +1,8 @@
 # Direct methods to be overloaded onto the client
 import logging
-import time
-from typing import Any, Dict, Tuple
+from typing import Any, Dict, List, Tuple
+
+import numpy
 
 from .zmq_client import HWClientInstance
 
@@ -26,6 +27,9 @@ class GCoderDevice(HWClientInstance):
     def in_motion(self) -> bool:
         return self._wrap_method()
 
+    def report_count(self) -> int:
+        return self._wrap_method()
+
     # Simple wrapped operation methods
     def reset_devices(self, config: Dict[str, Any]):
         return self._wrap_method(config)
@@ -33,6 +37,9 @@ class GCoderDevice(HWClientInstance):
     def run_gcoder(self, cmd: str) -> str:
         return self._wrap_method(cmd)
 
+    def run_gcode_batch(self, cmds: List[str]) -> str:
+        return self._wrap_method(cmds)
+
     def enable_stepper(self, x: bool, y: bool, z: bool):
         return self._wrap_method(x, y, z)
 
@@ -45,13 +52,27 @@ class GCoderDevice(HWClientInstance):
     def set_speed_limit(self, x: float, y: float, z: float):
         return self._wrap_method(x, y, z)
 
+    def set_auto_report(self, interval: int):
+        return self._wrap_method(interval)
+
     # Wrapped method for move_to
     def _raw_move_to_(self, x: float, y: float, z: float):
         return self.client.run_function(
             hw_name=self.name, function_name="move_to", x=x, y=y, z=z
         )
 
+    def move_to_and_wait(
+        self, x: float, y: float, z: float
+    ) -> Tuple[float, float, float]:
+        return self._wrap_method(x, y, z)
+
+    def wait_motion(self) -> Tuple[float, float, float]:
+        return self._wrap_method()
+
     def move_to(self, x: float, y: float, z: float):
-        self._raw_move_to_(x, y, z)
-        while self.in_motion():
-            time.sleep(0.01)
+        return self.move_to_and_wait(x, y, z)
+
+    def run_trajectory(
+        self, points: numpy.ndarray, dwell_ms: int = 0, reorder: bool = True
+    ) -> numpy.ndarray:
+        return self._wrap_method(points, dwell_ms, reorder)
@@ -1,16 +1,22 @@
+import asyncio
+import contextlib
+import contextvars
 import inspect
+import itertools
 import logging
 import os
-import pickle
+import sys
 from socket import gethostname
-from typing import List
+from typing import Any, AsyncIterator, Dict, Iterator, List, Optional, Tuple
 
 import zmq
+import zmq.asyncio
 
 # hack to have different import behaviors for loading server side descriptions
 os.environ["GMQPACKAGE_IS_CLIENT"] = "1"
 
 # Needs to be placed here
+from .server import zmq_wire
 from .server.zmq_server import HWBaseInstance
 
 
@@ -21,6 +27,17 @@ def make_zmq_client_socket(host: str, port: int) -> zmq.Socket:
     return socket
 
 
+def make_zmq_async_client_socket(host: str, port: int) -> zmq.asyncio.Socket:
+    """
+    DEALER socket for the asynchronous client, which allows for multiple
+    outstanding requests, unlike the REQ socket.
+    """
+    context = zmq.asyncio.Context()
+    socket = context.socket(zmq.DEALER)
+    socket.connect(f"tcp://{host}:{port}")
+    return socket
+
+
 def add_serverclass_doc(serverclass):
     """
     Extracting the __doc__ string of the server-side class and setting this as
@@ -77,6 +94,20 @@ class HWClientInstance(object):
     Base class for running a server side methods
     """
 
+    # Mapping of the code objects of the methods to the method names, such that
+    # the method calling _wrap_method can be identified without inspecting the
+    # full call stack. Filled in at class creation.
+    _method_names: Dict[Any, str] = {}
+
+    def __init_subclass__(cls, **kwargs):
+        super().__init_subclass__(**kwargs)
+        cls._method_names = {}
+        for base in reversed(cls.__mro__):
+            for name, method in vars(base).items():
+                # Aliases of a method use the name of the original definition
+                if inspect.isfunction(method):
+                    cls._method_names.setdefault(method.__code__, name)
+
     def __init__(self, name: str):
         self.name = name
         self.client: HWControlClient = None
@@ -86,9 +117,10 @@ class HWClientInstance(object):
         Helper function for calling a thing wrapper based on the method name in
         the call stack and the defined name of the hardware we wish to control.
         """
+        code = sys._getframe(1).f_code
         return self.client.run_function(
             self.name,
-            inspect.stack()[1][3],
+            self._method_names.get(code, code.co_name),
             *args,
             **kwargs,
         )
@@ -106,6 +138,95 @@ class HWClientInstance(object):
         return self._wrap_method()
 
 
+class HWStreamSubscriber(object):
+    """
+    Subscriber to the data streams published by the server. Each subscriber
+    uses its own socket, so any number of monitoring clients can receive the
+    same streams without going through the control socket of the server.
+    Messages are dropped if more than hwm messages are waiting to be received.
+    """
+
+    def __init__(
+        self, context: zmq.Context, address: str, topics: List[str], hwm: int = 16
+    ):
+        self.socket = context.socket(zmq.SUB)
+        self.socket.setsockopt(zmq.RCVHWM, hwm)
+        self.socket.connect(address)
+        for topic in topics:
+            self.socket.setsockopt(zmq.SUBSCRIBE, topic.encode())
+
+    def recv(self, timeout: Optional[float] = None) -> Optional[Tuple[str, float, Any]]:
+        """
+        Receiving the next stream message as (topic, server time, data). If
+        a timeout in seconds is given, returns None if no message is received
+        within the timeout.
+        """
+        if timeout is not None and not self.socket.poll(int(timeout * 1000)):
+            return None
+        frames = self.socket.recv_multipart(copy=False)
+        message = zmq_wire.loads(frames[1:])
+        return frames[0].bytes.decode(), message["time"], message["data"]
+
+    def __iter__(self) -> Iterator[Tuple[str, float, Any]]:
+        while True:
+            yield self.recv()
+
+    def close(self):
+        self.socket.close()
+
+
+class HWAsyncStreamSubscriber(HWStreamSubscriber):
+    """
+    Asynchronous version of the stream subscriber, where receiving a message
+    awaits on the socket instead of blocking the event loop:
+
+    ```python
+    async for topic, time, data in await client.subscribe(["gcoder.position"]):
+        ...
+    ```
+    """
+
+    async def recv(
+        self, timeout: Optional[float] = None
+    ) -> Optional[Tuple[str, float, Any]]:
+        """Asynchronous version of HWStreamSubscriber.recv"""
+        if timeout is not None and not await self.socket.poll(int(timeout * 1000)):
+            return None
+        frames = await self.socket.recv_multipart(copy=False)
+        message = zmq_wire.loads(frames[1:])
+        return frames[0].bytes.decode(), message["time"], message["data"]
+
+    async def __aiter__(self) -> AsyncIterator[Tuple[str, float, Any]]:
+        while True:
+            yield await self.recv()
+
+
+class HWBatchResult(object):
+    """
+    Result of a function call made in a batch, only available once the batch
+    is sent.
+    """
+
+    def __init__(self):
+        self.response: Optional[Dict[str, Any]] = None
+
+    def result(self) -> Any:
+        """Return value of the function, raising the server side exception."""
+        assert self.response is not None, "Batch has not been sent"
+        if "exception" in self.response:
+            raise self.response["exception"]
+        return self.response["return"]
+
+
+class HWBatch(object):
+    """Requests and results of a batch or macro being collected."""
+
+    def __init__(self, macro: bool):
+        self.requests: List[Dict[str, Any]] = []
+        self.results: List[HWBatchResult] = []
+        self.macro = macro
+
+
 class HWControlClient(object):
     def __init__(
         self,
@@ -121,6 +242,11 @@ class HWControlClient(object):
         for hw in self.hw_list:
             hw.client = self
 
+        # Batch currently being collected. This is scoped to the current
+        # context (thread or asyncio task), so that calls made elsewhere are not
+        # collected into the batch.
+        self._batch = contextvars.ContextVar(f"gmq_batch_{id(self)}", default=None)
+
     def is_operator(self) -> bool:
         """
         Checking if this client is the operator that is allowed to call
@@ -136,6 +262,29 @@ class HWControlClient(object):
         """Relinquish the use of operation methods"""
         return self.run_function(hw_name="", function_name="release_operator")
 
+    def stream_info(self) -> Dict[str, Any]:
+        """
+        Port of the server PUB socket (None if streams are not published), and
+        the publishing rates of the available streams in Hz.
+        """
+        return self.run_function(hw_name="", function_name="stream_info")
+
+    def subscribe(self, topics: List[str], hwm: int = 16) -> HWStreamSubscriber:
+        """
+        Subscribing to the server data streams, topics are given as
+        "<hw_name>.<stream>" (ex: "gcoder.position"), see `stream_info` for the
+        streams published by the server.
+        """
+        info = self.stream_info()
+        assert info["port"] is not None, "Server is not publishing data streams"
+        for topic in topics:
+            assert topic in info["rates"], f"Stream [{topic}] is not published"
+        endpoint = self.socket.getsockopt_string(zmq.LAST_ENDPOINT)
+        host = endpoint.rsplit(":", 1)[0]
+        return HWStreamSubscriber(
+            self.socket.context, f"{host}:{info['port']}", topics, hwm
+        )
+
     def close(self):
         """
         Always attempt to release the operator on exit. For methods in the
@@ -151,24 +300,152 @@ class HWControlClient(object):
         Running a function on the server side. The function is should be
         uniquely identified by the hardware instance name, and the method used.
         All other arguments will be passed as a collection of iterable *args
-        and mapping **kwargs.
-        """
-        # Sending function inputs
-        self.socket.send(
-            pickle.dumps(
-                dict(
-                    client_id=self.client_id,
-                    hw_name=hw_name,
-                    function_name=function_name,
-                    args=args,
-                    kwargs=kwargs,
-                )
-            )
-        )
+        and mapping **kwargs. Within a batch, the function is not run
+        immediately, and a HWBatchResult is returned instead.
+        """
+        request = self._make_request(hw_name, function_name, args, kwargs)
+        if self._batch.get() is not None:
+            return self._add_to_batch(request)
 
-        # Getting raw response
-        response = pickle.loads(self.socket.recv())
+        # Sending function inputs and getting raw response
+        zmq_wire.send(self.socket, request)
+        return self._parse_response(zmq_wire.recv(self.socket))
+
+    @contextlib.contextmanager
+    def batch(self) -> Iterator[List[HWBatchResult]]:
+        """
+        Collecting all function calls made within the context, sending them to
+        the server as a single message once the context exits. The yielded list
+        is filled with the results of the calls in order, with the return
+        values available once the context exits:
+
+        ```python
+        with client.batch() as results:
+            client.hvlv.get_hv_mv()
+            client.gcoder.get_coord()
+        hv, coord = [x.result() for x in results]
+        ```
+
+        Calls to different hardware instances may be processed concurrently by
+        the server, so calls in a batch should not depend on each other.
+        """
+        results, token = self._start_batch()
+        try:
+            yield results
+        except BaseException:
+            self._end_batch(token)
+            raise
+        request = self._end_batch(token)
+        if request["batch"]:
+            zmq_wire.send(self.socket, request)
+            self._parse_batch_response(results, zmq_wire.recv(self.socket))
+
+    def run_batch(self, steps: List[Any], interval: float = 0.05) -> List[Any]:
+        """
+        Running a sequence of function calls server side in a single request,
+        returning the list of return values. See HWControlServer.run_batch for
+        the format of the steps, or use the `macro` context to construct the
+        steps from the hardware client methods.
+        """
+        return self.run_function("", "run_batch", steps, interval=interval)
 
+    @contextlib.contextmanager
+    def macro(self, interval: float = 0.05) -> Iterator[List[HWBatchResult]]:
+        """
+        Collecting all function calls made within the context, running them in
+        order server side in a single request once the context exits. Unlike
+        `batch`, the calls are run sequentially, and a call can be turned into
+        a wait step using `wait_until`:
+
+        ```python
+        with client.macro() as results:
+            client.gcoder.move_to(10, 20, 5)
+            client.wait_until(client.gcoder.in_motion(), False, timeout=30)
+            client.gcoder.disable_stepper(True, True, True)
+            client.drs.start_collection()
+            client.drs.get_waveform(0)
+            client.gcoder.enable_stepper(True, True, True)
+        waveform = results[4].result()
+        ```
+
+        Processing stops at the first failed call, with the error raised here.
+        """
+        results, token = self._start_batch(macro=True)
+        try:
+            yield results
+        except BaseException:
+            self._end_batch(token)
+            raise
+        steps = self._end_batch(token)["batch"]
+        if steps:
+            self._set_macro_results(results, self.run_batch(steps, interval))
+
+    def wait_until(
+        self,
+        result: HWBatchResult,
+        value: Any,
+        compare: str = "==",
+        timeout: float = 60.0,
+    ) -> HWBatchResult:
+        """
+        Within a macro, turning a call into a wait step: the call is repeated
+        until the comparison (one of ==, !=, <, <=, >, >=) of the return value
+        with the given value is true, or failing the macro after timeout
+        seconds. The result of the step is the last return value.
+        """
+        batch = self._batch.get()
+        assert (
+            batch is not None and batch.macro
+        ), "wait_until can only be used within a macro"
+        index = next(i for i, x in enumerate(batch.results) if x is result)
+        until = dict(value=value, compare=compare, timeout=timeout)
+        batch.requests[index]["until"] = until
+        return result
+
+    def _make_request(
+        self, hw_name: str, function_name: str, args: Tuple[Any], kwargs: Dict
+    ) -> Dict[str, Any]:
+        return dict(
+            client_id=self.client_id,
+            hw_name=hw_name,
+            function_name=function_name,
+            args=args,
+            kwargs=kwargs,
+        )
+
+    def _start_batch(
+        self, macro: bool = False
+    ) -> Tuple[List[HWBatchResult], contextvars.Token]:
+        assert self._batch.get() is None, "Batches cannot be nested"
+        batch = HWBatch(macro)
+        return batch.results, self._batch.set(batch)
+
+    def _add_to_batch(self, request: Dict[str, Any]) -> HWBatchResult:
+        batch = self._batch.get()
+        batch.requests.append(request)
+        batch.results.append(HWBatchResult())
+        return batch.results[-1]
+
+    def _end_batch(self, token: contextvars.Token) -> Dict[str, Any]:
+        requests = self._batch.get().requests
+        self._batch.reset(token)
+        return {"batch": requests}
+
+    def _set_macro_results(self, results: List[HWBatchResult], ret: List[Any]):
+        for result, value in zip(results, ret):
+            result.response = {"return": value}
+
+    def _parse_batch_response(
+        self, results: List[HWBatchResult], response: Dict[str, Any]
+    ) -> None:
+        if "batch" not in response:  # Message could not be processed
+            self._parse_response(response)
+        for result, item in zip(results, response["batch"]):
+            for record in item["messages"]:
+                self.logger.handle(record)
+            result.response = item
+
+    def _parse_response(self, response: Dict[str, Any]) -> Any:
         # Re-emitting the message information
         for record in response["messages"]:
             self.logger.handle(record)
@@ -185,6 +462,124 @@ class HWControlClient(object):
             return response["return"]
 
 
+class HWAsyncControlClient(HWControlClient):
+    """
+    Asynchronous version of the client, where function calls return
+    coroutines. Multiple requests can be outstanding at the same time, the
+    responses are matched to the requests by a request ID carried in the
+    message envelope, as responses to requests to different hardware instances
+    may be returned out of order.
+    """
+
+    def __init__(
+        self,
+        socket: zmq.asyncio.Socket,
+        logger: logging.Logger,
+        hw_list: List[HWClientInstance],
+    ):
+        super().__init__(socket, logger, hw_list)
+        self._request_ids = itertools.count()
+        self._pending: Dict[bytes, asyncio.Future] = {}
+        self._receiver: Optional[asyncio.Task] = None
+
+    def run_function(self, hw_name: str, function_name: str, *args, **kwargs):
+        """
+        Returns a coroutine running the function on the server side. Within a
+        batch, a HWBatchResult is returned immediately instead.
+        """
+        request = self._make_request(hw_name, function_name, args, kwargs)
+        if self._batch.get() is not None:
+            return self._add_to_batch(request)
+        return self._run_request(request)
+
+    async def _run_request(self, request: Dict[str, Any]) -> Any:
+        return self._parse_response(await self._send_request(request))
+
+    async def _send_request(self, request: Dict[str, Any]) -> Dict[str, Any]:
+        if self._receiver is None or self._receiver.done():
+            self._receiver = asyncio.ensure_future(self._receive())
+        request_id = next(self._request_ids).to_bytes(8, "little")
+        future = asyncio.get_running_loop().create_future()
+        self._pending[request_id] = future
+        try:
+            await self.socket.send_multipart(
+                [request_id, b""] + zmq_wire.dumps(request), copy=False
+            )
+            return await future
+        finally:
+            self._pending.pop(request_id, None)
+
+    async def _receive(self) -> None:
+        """Passing the received responses to the pending requests."""
+        while True:
+            frames = await self.socket.recv_multipart(copy=False)
+            future = self._pending.get(frames[0].bytes)
+            if future is None or future.done():
+                continue
+            try:
+                future.set_result(zmq_wire.loads(frames[2:]))
+            except Exception as err:
+                future.set_exception(err)
+
+    @contextlib.asynccontextmanager
+    async def batch(self) -> AsyncIterator[List[HWBatchResult]]:
+        """
+        Asynchronous version of the batch context, see HWControlClient.batch.
+        Only the calls made by the current task (and tasks created within the
+        context) are collected into the batch, calls made by other tasks on the
+        same client are sent as usual.
+        """
+        results, token = self._start_batch()
+        try:
+            yield results
+        except BaseException:
+            self._end_batch(token)
+            raise
+        request = self._end_batch(token)
+        if request["batch"]:
+            self._parse_batch_response(results, await self._send_request(request))
+
+    @contextlib.asynccontextmanager
+    async def macro(self, interval: float = 0.05) -> AsyncIterator[List[HWBatchResult]]:
+        """
+        Asynchronous version of the macro context, see HWControlClient.macro.
+        """
+        results, token = self._start_batch(macro=True)
+        try:
+            yield results
+        except BaseException:
+            self._end_batch(token)
+            raise
+        steps = self._end_batch(token)["batch"]
+        if steps:
+            self._set_macro_results(results, await self.run_batch(steps, interval))
+
+    async def subscribe(
+        self, topics: List[str], hwm: int = 16
+    ) -> HWAsyncStreamSubscriber:
+        """
+        Subscribing to the server data streams, see HWControlClient.subscribe.
+        The subscriber shares the asyncio context of the client socket.
+        """
+        info = await self.stream_info()
+        assert info["port"] is not None, "Server is not publishing data streams"
+        for topic in topics:
+            assert topic in info["rates"], f"Stream [{topic}] is not published"
+        endpoint = self.socket.getsockopt_string(zmq.LAST_ENDPOINT)
+        host = endpoint.rsplit(":", 1)[0]
+        return HWAsyncStreamSubscriber(
+            self.socket.context, f"{host}:{info['port']}", topics, hwm
+        )
+
+    async def close(self):
+        """Releasing the operator if claimed, and closing the socket."""
+        if await self.is_operator():
+            await self.release_operator()
+        if self._receiver is not None:
+            self._receiver.cancel()
+        self.socket.close()
+
+
 if __name__ == "__main__":
     # Setting up a logger to has everything
     logging.root.setLevel(1)
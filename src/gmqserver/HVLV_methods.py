@@ -3,10 +3,13 @@ import logging
 import os
 from typing import Any, Dict, List, Optional
 
+import numpy
+
 if "GMQPACKAGE_IS_CLIENT" not in os.environ:
     from zmq_server import HWBaseInstance
 
     from modules.gpio import gpio
+    from modules.hv_regulator import hv_regulator
     from modules.i2c_ads1115 import i2c_ads1115
     from modules.i2c_mcp4725 import i2c_mcp4725
 else:
@@ -23,6 +26,9 @@ class HVLVDevice(HWBaseInstance):
         self.hvlv_adc: Optional[i2c_ads1115] = None
         self.hv_dac: Optional[i2c_mcp4725] = None
         self.lv_dac: Optional[i2c_mcp4725] = None
+        self.hv_reg: Optional[hv_regulator] = None
+        self.hv_target: Optional[float] = None  # For dummy regulation
+        self.adc_max_age: float = 0  # Maximum age of sampled values [s]
 
     def is_initialized(self):
         return True  # Always available to receive
@@ -47,7 +53,11 @@ class HVLVDevice(HWBaseInstance):
         Notice that if any 1 of the entries here is listed as "dummy", case
         insensitive, the entire item will be listed as a dummy device.
         """
-        # Closing all devices
+        # Closing all devices, the regulator must be closed first as it uses
+        # the ADC and DAC
+        if self.hv_reg is not None:
+            del self.hv_reg
+            self.hv_reg = None
         if self.hv_gpio is not None:
             del self.hv_gpio
             self.hv_gpio = None
@@ -89,6 +99,29 @@ class HVLVDevice(HWBaseInstance):
             self.hv_dac = i2c_mcp4725(1, int(dev_conf["HV_DAC_ADDR"], base=16))
             self.lv_dac = i2c_mcp4725(1, int(dev_conf["LV_DAC_ADDR"], base=16))
 
+            # Readout channels are sampled in the background, so telemetry
+            # requests do not need to wait for the ADC conversions
+            channels = [0, 1, 3]
+            rate = i2c_ads1115.ADS_RATE_860SPS
+            self.hvlv_adc.start_sampler(
+                channels,
+                [
+                    i2c_ads1115.ADS_RANGE_1V,
+                    i2c_ads1115.ADS_RANGE_4V,
+                    i2c_ads1115.ADS_RANGE_6V,
+                ],
+                rate,
+            )
+            # Each channel is sampled once every len(channels) conversions,
+            # allowing some slack for the conversions delayed by the other
+            # devices on the I2C bus
+            conversion_s = i2c_ads1115.conversion_us(rate) * 1e-6
+            self.adc_max_age = 10 * len(channels) * conversion_s
+            # Closed-loop regulation of the HV, only started on request
+            self.hv_reg = hv_regulator(
+                self.hv_dac, self.hvlv_adc, 0, i2c_ads1115.ADS_RANGE_1V, 101
+            )
+
             # Disable HV on start up
             self.hv_gpio.write(0)
         else:
@@ -98,7 +131,11 @@ class HVLVDevice(HWBaseInstance):
             self.lv_dac = None
 
     def hv_enable(self):
-        """Enable the high-voltage power rail"""
+        """
+        Enable the high-voltage power rail. Any regulation is stopped first, so
+        the rail is never switched on while the loop is driving the DAC.
+        """
+        self.stop_hv_regulation()
         if not self.is_dummy():
             self.hv_gpio.write(True)
         else:
@@ -106,6 +143,7 @@ class HVLVDevice(HWBaseInstance):
 
     def hv_disable(self):
         """Disable the high-voltage power rail"""
+        self.stop_hv_regulation()
         if not self.is_dummy():
             self.hv_gpio.write(False)
         else:
@@ -125,12 +163,79 @@ class HVLVDevice(HWBaseInstance):
         """
         # TODO: Handle proper operation of VDD
         assert 0 <= target <= 5000
+        self.stop_hv_regulation()
         vdd = self.get_vdd_mv()
         if not self.is_dummy():
             self.hv_dac.set_int(int(4095 * float(target / vdd)))
         else:
             self.hv_dac = target
 
+    def ramp_hv_control_mv(self, target: float, duration: float = 1.0):
+        """
+        Linearly ramping the control voltage for adjusting the high-voltage rail
+        from the current value to the target value (units in mV) over a duration
+        in seconds. The ramp is performed by the DAC interface with 1ms steps,
+        so the ramp is not subjected to the python and network timing jitter.
+        """
+        assert 0 <= target <= 5000
+        assert 0 < duration <= 60
+        self.stop_hv_regulation()
+        vdd = self.get_vdd_mv()
+        if not self.is_dummy():
+            period_us = 1000
+            n_steps = max(int(duration * 1e6 / period_us), 2)
+            start = self.hv_dac.read_int()
+            stop = int(4095 * float(target / vdd))
+            values = numpy.linspace(start, stop, n_steps).round().astype(numpy.uint16)
+            self.hv_dac.ramp(values, period_us)
+        else:
+            self.hv_dac = target
+
+    def regulate_hv_mv(self, target: float, slew: float = 10000):
+        """
+        Regulating the high-voltage rail to the target value (units in mV) with
+        a closed loop running on the server. The value will move toward the
+        target no faster than the slew limit in mV/s (0 for no limit).
+        Regulation continues until stop_hv_regulation is called, or the HV
+        control voltage is set manually. The high-voltage rail must be enabled
+        before regulation can be started.
+        """
+        assert 0 <= target <= 80000
+        assert slew >= 0
+        if not self.get_hv_status():
+            raise RuntimeError("High-voltage rail is disabled, cannot regulate")
+        if not self.is_dummy():
+            self.hv_reg.set_slew(slew)
+            self.hv_reg.set_target(target)
+        else:
+            self.hv_target = target
+
+    def stop_hv_regulation(self):
+        """Stopping the HV regulation, keeping the control voltage as is"""
+        if not self.is_dummy():
+            self.hv_reg.stop()
+        else:
+            self.hv_target = None
+
+    def get_hv_regulation_status(self) -> Dict[str, Any]:
+        """
+        Status of the HV regulation loop: target, slew-limited setpoint and
+        latest readout, error, DAC output, and the time taken for the HV to
+        settle after the last target change (negative if not settled). Units in
+        mV and seconds.
+        """
+        fields = ["running", "fault", "target", "setpoint", "measured", "error"]
+        fields += ["error_rms", "dac", "settled", "settle_time", "iterations"]
+        if not self.is_dummy():
+            status = self.hv_reg.status()
+            return {x: getattr(status, x) for x in fields}
+        else:
+            running = self.hv_target is not None
+            target = self.hv_target if running else 0
+            status = dict(zip(fields, [running, False] + [target] * 3 + [0] * 6))
+            status.update({"settled": running})
+            return status
+
     def set_lv_mv(self, target: float):
         """Setting the low-voltage rail value. Units in mV"""
         # TODO: Handle proper operation of VDD
@@ -141,11 +246,26 @@ class HVLVDevice(HWBaseInstance):
         else:
             self.lv_dac = target
 
+    def _read_adc_mv(self, channel: int, adc_range: int) -> float:
+        """
+        Latest value of the background sampler, falling back to a direct ADC
+        readout if no samples are available, or if the latest sample is older
+        than expected (ex: the sampler is stalled by failed conversions).
+        """
+        if self.hvlv_adc.sampler_running():
+            try:
+                stats = self.hvlv_adc.summary(channel)
+                if stats.age <= self.adc_max_age:
+                    return stats.latest
+            except RuntimeError:
+                pass
+        return self.hvlv_adc.read_mv(channel, adc_range)
+
     def get_hv_mv(self) -> float:
         """Returning the high-voltage rail voltage value. Units in mV"""
         if not self.is_dummy():
             # TODO: 101 from multiple divider values. Programmable??
-            return self.hvlv_adc.read_mv(0, i2c_ads1115.ADS_RANGE_1V) * 101
+            return self._read_adc_mv(0, i2c_ads1115.ADS_RANGE_1V) * 101
         else:
             if self.get_hv_status():
                 # TODO better indirect estimate based on control voltage
@@ -156,7 +276,7 @@ class HVLVDevice(HWBaseInstance):
     def get_hv_control_mv(self) -> float:
         """Returning the high-voltage rail control voltage. Units in mV"""
         if not self.is_dummy():
-            return self.hvlv_adc.read_mv(1, i2c_ads1115.ADS_RANGE_4V)
+            return self._read_adc_mv(1, i2c_ads1115.ADS_RANGE_4V)
         else:
             return self.hv_dac
 
@@ -174,10 +294,52 @@ class HVLVDevice(HWBaseInstance):
     def get_vdd_mv(self) -> float:
         """Returning the primary power rail voltage. Units in mV"""
         if not self.is_dummy():
-            return self.hvlv_adc.read_mv(3, i2c_ads1115.ADS_RANGE_6V)
+            return self._read_adc_mv(3, i2c_ads1115.ADS_RANGE_6V)
         else:
             return 5000
 
+    def get_adc_summary(self, channel: int, window: int = 0) -> Dict[str, float]:
+        """
+        Summary of the background samples of an ADC channel (0: HV divider, 1:
+        HV control, 3: VDD), values in units of mV at the ADC input. If window
+        is 0, statistics are accumulated since the devices were reset, otherwise
+        only the last window samples are used. age is the time since the latest
+        sample in seconds.
+        """
+        assert channel in [0, 1, 3]
+        if not self.is_dummy():
+            stats = self.hvlv_adc.summary(channel, window)
+            return {
+                x: getattr(stats, x)
+                for x in ["n", "latest", "age", "mean", "stddev", "min", "max"]
+            }
+        else:
+            value = {
+                0: lambda: self.get_hv_mv() / 101,
+                1: self.get_hv_control_mv,
+                3: self.get_vdd_mv,
+            }[channel]()
+            return {
+                "n": 0,
+                "latest": value,
+                "age": 0,
+                "mean": value,
+                "stddev": 0,
+                "min": value,
+                "max": value,
+            }
+
+    def get_adc_telemetry(self) -> Dict[str, float]:
+        """
+        Latest readout of the HV rail, the HV control voltage and the primary
+        power rail. Units in mV.
+        """
+        return {
+            "hv": self.get_hv_mv(),
+            "hv_control": self.get_hv_control_mv(),
+            "vdd": self.get_vdd_mv(),
+        }
+
     @property
     def telemetry_methods(self) -> List[str]:
         return [
@@ -186,8 +348,16 @@ class HVLVDevice(HWBaseInstance):
             "get_hv_control_mv",
             "get_lv_mv",
             "get_vdd_mv",
+            "get_adc_summary",
+            "get_adc_telemetry",
+            "get_hv_regulation_status",
         ]
 
+    @property
+    def stream_methods(self) -> Dict[str, str]:
+        # ADC channels are sampled in the background
+        return {"adc": "get_adc_telemetry"}
+
     @property
     def operation_methods(self) -> List[str]:
         return [
@@ -195,6 +365,9 @@ class HVLVDevice(HWBaseInstance):
             "hv_enable",
             "hv_disable",
             "set_hv_control_mv",
+            "ramp_hv_control_mv",
+            "regulate_hv_mv",
+            "stop_hv_regulation",
             "set_lv_mv",
         ]
 
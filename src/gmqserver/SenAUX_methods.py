@@ -8,22 +8,21 @@ import numpy
 if "GMQPACKAGE_IS_CLIENT" not in os.environ:
     from zmq_server import HWBaseInstance
 
-    from modules.gpio import gpio
+    from modules.gpio import gpio_bank
     from modules.i2c_ads1115 import i2c_ads1115
 else:
     from gmqclient.server.zmq_server import HWBaseInstance
 
-    gpio = None
+    gpio_bank = None
     i2c_ads1115 = None
 
 
 class SenAUXDevice(HWBaseInstance):
     def __init__(self, name: str, logger: logging.Logger):
         super().__init__(name, logger)
-        self.pd1_gpio: Union[bool, gpio] = False
-        self.pd2_gpio: Union[bool, gpio] = False
-        self.f1_gpio: Optional[gpio] = None
-        self.f2_gpio: Optional[gpio] = None
+        self.pd_gpio: Optional[gpio_bank] = None  # Lines PD1 and PD2
+        self.pd_dummy: List[bool] = [False, False]
+        self.fast_gpio: Optional[gpio_bank] = None  # Lines F1 and F2
         self.sen_adc: Optional[i2c_ads1115] = None
         self.resdiv_1: Tuple[float, float] = (10000, 0)
         self.resdiv_2: Tuple[float, float] = (10000, 0)
@@ -33,7 +32,7 @@ class SenAUXDevice(HWBaseInstance):
         return True
 
     def is_dummy(self):
-        return not isinstance(self.f1_gpio, gpio)
+        return not isinstance(self.fast_gpio, gpio_bank)
 
     def reset_devices(self, device_json: Dict[str, Any]):
         """
@@ -61,14 +60,10 @@ class SenAUXDevice(HWBaseInstance):
         """
 
         # Closing everything
-        del self.pd1_gpio
-        self.pd1_gpio = None
-        del self.pd2_gpio
-        self.pd2_gpio = None
-        del self.f1_gpio
-        self.f1_gpio = None
-        del self.f2_gpio
-        self.f2_gpio = None
+        del self.pd_gpio
+        self.pd_gpio = None
+        del self.fast_gpio
+        self.fast_gpio = None
         del self.sen_adc
         self.sen_adc = None
 
@@ -101,16 +96,27 @@ class SenAUXDevice(HWBaseInstance):
             ]
         )
         if is_dummy:
-            self.pd1_gpio = False
-            self.pd2_gpio = False
-            self.f1_gpio = None
-            self.f2_gpio = None
+            self.pd_gpio = None
+            self.pd_dummy = [False, False]
+            self.fast_gpio = None
             self.sen_adc = None
         else:
-            self.pd1_gpio = gpio(int(device_json["SENAUX_PD1_GPIO"]))
-            self.pd2_gpio = gpio(int(device_json["SENAUX_PD2_GPIO"]))
-            self.f1_gpio = gpio(int(device_json["SENAUX_F1_GPIO"]))
-            self.f2_gpio = gpio(int(device_json["SENAUX_F2_GPIO"]))
+            # Power delivery lines are held in a single bank, so the chip is
+            # not opened and closed for every toggle or status check
+            self.pd_gpio = gpio_bank(
+                [
+                    int(device_json["SENAUX_PD1_GPIO"]),
+                    int(device_json["SENAUX_PD2_GPIO"]),
+                ]
+            )
+            # Fast pulse lines are held in a single bank, so they can be
+            # pulsed in lockstep
+            self.fast_gpio = gpio_bank(
+                [
+                    int(device_json["SENAUX_F1_GPIO"]),
+                    int(device_json["SENAUX_F2_GPIO"]),
+                ]
+            )
             self.sen_adc = i2c_ads1115(
                 1, int(device_json["SENAUX_ADC"]["ADDR"], base=16)
             )
@@ -118,61 +124,112 @@ class SenAUXDevice(HWBaseInstance):
             self.resdiv_2 = tuple(device_json["SENAUX_ADC"]["C2"])
             self.resdiv_3 = tuple(device_json["SENAUX_ADC"]["C3"])
             # Disable power delivery on start up
-            self.pd1_gpio.write(0)
-            self.pd2_gpio.write(0)
+            self.pd_gpio.write([0, 0])
 
-    @classmethod
-    def _write_gpio(cls, dev: Union[bool, gpio], val: bool):
+    def _write_pd(self, index: int, val: bool):
         """Helper method for dummy device processing"""
-        if isinstance(dev, gpio):
-            dev.write(val)
+        if isinstance(self.pd_gpio, gpio_bank):
+            self.pd_gpio.write_line(index, val)
         else:
-            dev = val
+            self.pd_dummy[index] = val
 
-    @classmethod
-    def _stat_gpio(cls, dev: Union[bool, gpio]) -> bool:
+    def _stat_pd(self, index: int) -> bool:
         """Helper method for dummy device"""
-        if isinstance(dev, gpio):
-            return dev.read()
+        if isinstance(self.pd_gpio, gpio_bank):
+            return bool(self.pd_gpio.read()[index])
         else:
-            return dev
+            return self.pd_dummy[index]
 
     def enable_pd1(self):
         """Enabling the power rail connected to power port channel 1"""
-        self._write_gpio(self.pd1_gpio, True)
+        self._write_pd(0, True)
 
     def disable_pd1(self):
         """Disabling the power rail connected to power port channel 1"""
-        self._write_gpio(self.pd1_gpio, False)
+        self._write_pd(0, False)
 
     def status_pd1(self) -> bool:
         """Checking the status of power rail on channel 1"""
-        return self._stat_gpio(self.pd1_gpio)
+        return self._stat_pd(0)
 
     def enable_pd2(self):
         """Enabling the power rail connected to power port channel 2"""
-        self._write_gpio(self.pd1_gpio, True)
+        self._write_pd(1, True)
 
     def disable_pd2(self):
         """Disabling the power rail connected to power port channel 2"""
-        self._write_gpio(self.pd1_gpio, False)
+        self._write_pd(1, False)
 
     def status_pd2(self) -> bool:
         """Checking the status of power rail on channel 2"""
-        return self._stat_gpio(self.pd1_gpio)
+        return self._stat_pd(1)
 
-    @classmethod
-    def _pulse_gpio(cls, dev: Union[bool, gpio], n: int, wait: int):
-        if isinstance(dev, gpio):
-            dev.pulse(n=n, wait=wait)
+    def _pulse_fast(self, lines: List[int], n: int, wait: int):
+        """Helper method for dummy device processing"""
+        if isinstance(self.fast_gpio, gpio_bank):
+            self.fast_gpio.pulse_train(lines, n=n, period=wait * 1000)
 
     def pulse_f1(self, n: int, w: int):
         """Pulsing the fast port 1, for n times, waiting for w microseconds"""
-        self._pulse_gpio(self.f1_gpio, n, w)
+        self._pulse_fast([0], n, w)
 
     def pulse_f2(self, n: int, w: int):
         """Pulsing the fast port 2, for n times, waiting for w microseconds"""
-        self._pulse_gpio(self.f2_gpio, n, w)
+        self._pulse_fast([1], n, w)
+
+    def pulse_f12(self, n: int, w: int):
+        """
+        Pulsing the fast ports 1 and 2 in lockstep, for n times, waiting for w
+        microseconds
+        """
+        self._pulse_fast([0, 1], n, w)
+
+    def _pulse_fast_async(self, lines: List[int], n: int, wait: int):
+        """Helper method for dummy device processing"""
+        if isinstance(self.fast_gpio, gpio_bank):
+            self.fast_gpio.pulse_async(lines, n=n, wait=wait)
+
+    def pulse_f1_async(self, n: int, w: int):
+        """
+        Pulsing the fast port 1 in the background, for n times, waiting for w
+        microseconds. Returns immediately, use pulse_status to monitor progress.
+        """
+        self._pulse_fast_async([0], n, w)
+
+    def pulse_f2_async(self, n: int, w: int):
+        """
+        Pulsing the fast port 2 in the background, for n times, waiting for w
+        microseconds. Returns immediately, use pulse_status to monitor progress.
+        """
+        self._pulse_fast_async([1], n, w)
+
+    def pulse_f12_async(self, n: int, w: int):
+        """
+        Pulsing the fast ports 1 and 2 in lockstep in the background, for n times,
+        waiting for w microseconds. Returns immediately, use pulse_status to
+        monitor progress.
+        """
+        self._pulse_fast_async([0, 1], n, w)
+
+    def pulse_status(self) -> Dict[str, Union[bool, int]]:
+        """
+        Status of the background pulse train: whether it is still running, the
+        number of completed pulses, and the total number of requested pulses.
+        """
+        if isinstance(self.fast_gpio, gpio_bank):
+            running, completed, total = self.fast_gpio.pulse_status()
+        else:
+            running, completed, total = False, 0, 0
+        return {"running": running, "completed": completed, "total": total}
+
+    def pulse_cancel(self) -> int:
+        """
+        Stopping the background pulse train, returns the number of completed
+        pulses.
+        """
+        if isinstance(self.fast_gpio, gpio_bank):
+            return self.fast_gpio.pulse_cancel()
+        return 0
 
     def adc_readmv(self, channel: int) -> float:
         """Reading the ADC voltage readout values of a particular channel"""
@@ -194,6 +251,7 @@ class SenAUXDevice(HWBaseInstance):
             "status_pd2",
             "adc_readmv",
             "adc_biasresistor",
+            "pulse_status",
         ]
 
     @property
@@ -206,6 +264,11 @@ class SenAUXDevice(HWBaseInstance):
             "disable_pd2",
             "pulse_f1",
             "pulse_f2",
+            "pulse_f12",
+            "pulse_f1_async",
+            "pulse_f2_async",
+            "pulse_f12_async",
+            "pulse_cancel",
         ]
 
 
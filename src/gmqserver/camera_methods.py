@@ -1,5 +1,6 @@
 import logging
 import os
+import threading
 from typing import Any, Dict, List, Optional
 
 import cv2
@@ -15,6 +16,8 @@ class CameraDevice(HWBaseInstance):
     def __init__(self, name: str, logger: logging.Logger):
         super().__init__(name, logger)
         self.device: Optional[cv2.VideoCapture] = None
+        # Frames may be requested by both the client and the frame stream
+        self._read_lock = threading.Lock()
 
     def is_initialized(self):
         return True
@@ -23,42 +26,49 @@ class CameraDevice(HWBaseInstance):
         return self.device is None
 
     def reset_devices(self, config: Dict[str, Any]):
-        # Closing everything
-        if isinstance(self.device, cv2.VideoCapture):
-            self.device.release()
-            self.device = None
-
         # Checking the configuration format
         assert self.name + "_device_path" in config
         dev_path = config[self.name + "_device_path"]
 
-        # Loading the camera instance into the data set
-        if "/dummy" not in dev_path:
-            self.device = cv2.VideoCapture(dev_path)
+        # The frame stream may be reading the device concurrently
+        with self._read_lock:
+            # Closing everything
+            if isinstance(self.device, cv2.VideoCapture):
+                self.device.release()
+                self.device = None
+
+            # Loading the camera instance into the data set
+            if "/dummy" not in dev_path:
+                device = cv2.VideoCapture(dev_path)
 
-            # Setting up the capture property
-            self.device.set(cv2.CAP_PROP_FRAME_WIDTH, 1240)
-            self.device.set(cv2.CAP_PROP_FRAME_HEIGHT, 1024)
-            self.device.set(cv2.CAP_PROP_BUFFERSIZE, 1)  # Always get latest frame
-            self.device.set(cv2.CAP_PROP_SHARPNESS, 0)  # Disable post processing
+                # Setting up the capture property
+                device.set(cv2.CAP_PROP_FRAME_WIDTH, 1240)
+                device.set(cv2.CAP_PROP_FRAME_HEIGHT, 1024)
+                device.set(cv2.CAP_PROP_BUFFERSIZE, 1)  # Always get latest frame
+                device.set(cv2.CAP_PROP_SHARPNESS, 0)  # Disable post processing
+                self.device = device
 
-        # Loading a dummy camera instance
+            # Loading a dummy camera instance
 
     def get_frame(self) -> numpy.ndarray:
-        if isinstance(self.device, cv2.VideoCapture):
+        with self._read_lock:
+            if not isinstance(self.device, cv2.VideoCapture):
+                return numpy.array([])
             if not self.device.isOpened():
                 raise RuntimeError("Video capture device is not available")
             ret, frame = self.device.read()
-            if not ret:
-                raise RuntimeError("Can't receive frame from capture device")
-            return frame
-        else:
-            return numpy.array([])
+        if not ret:
+            raise RuntimeError("Can't receive frame from capture device")
+        return frame
 
     @property
     def telemetry_methods(self) -> List[str]:
         return ["get_frame"]
 
+    @property
+    def stream_methods(self) -> Dict[str, str]:
+        return {"frame": "get_frame"}
+
     @property
     def operation_methods(self) -> List[str]:
         return ["reset_devices"]
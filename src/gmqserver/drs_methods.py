@@ -1,6 +1,6 @@
 import logging
 import os
-from typing import Any, Dict, List, Optional
+from typing import Any, Dict, List, Optional, Tuple
 
 import numpy
 
@@ -18,6 +18,7 @@ class DRSDevice(HWBaseInstance):
     def __init__(self, name: str, logger: logging.Logger):
         super().__init__(name, logger)
         self.device: Optional[drs] = None
+        self._stream_seq = 0  # Sequence number of the last published event
 
     def is_initialized(self):
         if self.device is None:
@@ -74,6 +75,78 @@ class DRSDevice(HWBaseInstance):
         """Stopping the currenct data collection routine"""
         return self.device.force_stop()
 
+    def collect_events(
+        self, n: int, channels: List[int], timeout: int = 0
+    ) -> numpy.ndarray:
+        """
+        Collecting n events with the current trigger settings in a single
+        call. Returns an array of shape (n, len(channels), samples) with
+        units in mV. The timeout for each event is in units of microseconds,
+        with 0 to wait indefinitely.
+        """
+        assert all(0 <= c <= 3 for c in channels)
+        return self.device.collect_events(n, channels, timeout)
+
+    def collect_waveformsums(
+        self,
+        n: int,
+        channels: List[int],
+        windows: List[Tuple[int, int, int, int]],
+        timeout: int = 0,
+    ) -> numpy.ndarray:
+        """
+        Collecting n events with the current trigger settings, returning only
+        the pedestal subtracted waveform sums as an array of shape
+        (n, len(channels)), with units in mV x ns. Windows are given as
+        (intstart, intstop, pedstart, pedstop) sample indices, either one per
+        channel, or a single window for all channels. The timeout for each
+        event is in units of microseconds, with 0 to wait indefinitely.
+        """
+        assert all(0 <= c <= 3 for c in channels)
+        return self.device.get_waveformsums(n, channels, windows, timeout)
+
+    def start_continuous(self, channels: List[int], capacity: int = 1024):
+        """
+        Starting the continuous acquisition of the listed channels, events are
+        collected in the background into a ring buffer that holds up to
+        capacity events. Other DRS operations are unavailable until the
+        acquisition is stopped.
+        """
+        assert all(0 <= c <= 3 for c in channels)
+        self._stream_seq = 0  # Event sequence restarts with the acquisition
+        return self.device.start_continuous(channels, capacity)
+
+    def stop_continuous(self):
+        """Stopping the continuous acquisition"""
+        return self.device.stop_continuous()
+
+    def drain_events(self, max_events: int, timeout: int = 100000) -> numpy.ndarray:
+        """
+        Extracting up to max_events from the continuous acquisition buffer,
+        waiting for up to timeout microseconds (0 to wait indefinitely) if the
+        buffer is empty. The wait also ends if the acquisition is stopped.
+        Returns an array of shape (n, len(channels), samples) with units in
+        mV. Notice that requests to the DRS are handled in order, so a call
+        with no timeout also holds back the stop_continuous request.
+        """
+        return self.device.drain_events(max_events, timeout)
+
+    def stream_events(self) -> Optional[numpy.ndarray]:
+        """
+        Latest event of the continuous acquisition, as an array of shape
+        (len(channels), samples), None if no acquisition is running or if no
+        new event was collected since the last call. The event is a copy made
+        by the acquisition thread, so the stream does not remove any events
+        from the acquisition buffer read by drain_events.
+        """
+        if self.device is None or not self.device.is_continuous():
+            return None
+        seq, event = self.device.latest_event()
+        if seq == self._stream_seq:
+            return None
+        self._stream_seq = seq
+        return event
+
     def run_calibration(self):
         """
         Running the DRS internal calibration routine. Because it is impossible
@@ -92,6 +165,11 @@ class DRSDevice(HWBaseInstance):
             "set_rate",
             "start_collection",
             "force_stop",
+            "collect_events",
+            "collect_waveformsums",
+            "start_continuous",
+            "stop_continuous",
+            "drain_events",
             "run_calibration",
         ]
 
@@ -134,6 +212,19 @@ class DRSDevice(HWBaseInstance):
         """Is the device ready for starting a set of data collection"""
         return self.device.is_ready()
 
+    def get_continuous_status(self) -> Dict[str, int]:
+        """
+        Status of the continuous acquisition: whether it is running, number
+        of events in the buffer, and number of events collected and dropped
+        since the acquisition was started.
+        """
+        return {
+            "running": self.device.is_continuous(),
+            "occupancy": self.device.ring_occupancy(),
+            "collected": self.device.collected_events(),
+            "dropped": self.device.dropped_events(),
+        }
+
     @property
     def telemetry_methods(self) -> List[str]:
         return [
@@ -146,8 +237,13 @@ class DRSDevice(HWBaseInstance):
             "get_samples",
             "get_rate",
             "is_ready",
+            "get_continuous_status",
         ]
 
+    @property
+    def stream_methods(self) -> Dict[str, str]:
+        return {"events": "stream_events"}
+
 
 if __name__ == "__main__":
     from zmq_server import (
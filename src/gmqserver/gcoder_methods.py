@@ -2,6 +2,8 @@ import logging
 import os
 from typing import Any, Dict, List, Tuple, Union
 
+import numpy
+
 if "GMQPACKAGE_IS_CLIENT" not in os.environ:
     from zmq_server import HWBaseInstance
 
@@ -27,6 +29,9 @@ class _DummyGantry_:
     def run_gcode(self, gcode: str) -> str:
         return "Dummy gantry_system, do nothing"
 
+    def run_gcode_batch(self, gcodes: List[str]) -> str:
+        return "Dummy gantry_system, do nothing"
+
     def set_speed_limit(self, x: float, y: float, z: float) -> None:
         self.vx, self.vy, self.vz = x, y, z
 
@@ -34,6 +39,31 @@ class _DummyGantry_:
         self.opx, self.opy, self.opz = x, y, z
         self.cx, self.cy, self.cz = x, y, z
 
+    def move_to_and_wait(
+        self, x: float, y: float, z: float
+    ) -> Tuple[float, float, float]:
+        self.move_to(x, y, z)
+        return self.wait_motion()
+
+    def wait_motion(self) -> Tuple[float, float, float]:
+        return self.cx, self.cy, self.cz
+
+    def run_trajectory(
+        self, points: numpy.ndarray, dwell_ms: int = 0, callback=None, reorder=True
+    ) -> numpy.ndarray:
+        points = numpy.asarray(points, dtype=numpy.float32)
+        for index, (x, y, z) in enumerate(points):
+            self.move_to(x, y, z)
+            if callback is not None:
+                callback(index, x, y, z)
+        return points.copy()
+
+    def set_auto_report(self, interval: int) -> None:
+        pass
+
+    def report_count(self) -> int:
+        return 0
+
     def enable_stepper(self, x: bool, y: bool, z: bool) -> None:
         pass
 
@@ -101,11 +131,22 @@ class GCoderDevice(HWBaseInstance):
         """Checking if the gantry is currently in motion"""
         return self.device.in_motion()
 
+    def report_count(self) -> int:
+        """Number of position reports received from the gantry"""
+        return self.device.report_count()
+
     # Operation methods
     def run_gcode(self, cmd: str) -> str:
         """Running a direct gcoder command"""
         return self.device.run_gcode(cmd)
 
+    def run_gcode_batch(self, cmds: List[str]) -> str:
+        """
+        Running a sequence of gcode commands, with multiple commands in flight
+        to keep the printer command buffer filled
+        """
+        return self.device.run_gcode_batch(cmds)
+
     def set_speed_limit(self, vx: float, vy: float, vz: float) -> None:
         """Setting the motion speed. Unit speed in mm/s"""
         return self.device.set_speed_limit(vx, vy, vz)
@@ -114,6 +155,42 @@ class GCoderDevice(HWBaseInstance):
         """Move to location. Unit in mm"""
         return self.device.move_to(x, y, z)
 
+    def move_to_and_wait(
+        self, x: float, y: float, z: float
+    ) -> Tuple[float, float, float]:
+        """
+        Move to location, and wait for the motion to complete. Returns the
+        final coordinates. Unit in mm
+        """
+        return tuple(self.device.move_to_and_wait(x, y, z))
+
+    def wait_motion(self) -> Tuple[float, float, float]:
+        """
+        Wait for all motion commands to complete. Returns the final
+        coordinates. Unit in mm
+        """
+        return tuple(self.device.wait_motion())
+
+    def run_trajectory(
+        self, points: numpy.ndarray, dwell_ms: int = 0, reorder: bool = True
+    ) -> numpy.ndarray:
+        """
+        Visiting a Nx3 array of coordinates in a single request, stopping at
+        each point for the dwell time in ms. Points are reordered to minimize
+        the travel distance unless reorder is set to false. Returns the Nx3
+        array of arrival coordinates, in the same order as the input points.
+        Unit in mm
+        """
+        points = numpy.asarray(points, dtype=numpy.float32).reshape(-1, 3)
+        return self.device.run_trajectory(points, dwell_ms=dwell_ms, reorder=reorder)
+
+    def set_auto_report(self, interval: int) -> None:
+        """
+        Setting the interval of the position auto-report in seconds, the
+        current coordinates will be updated without polling. 0 to disable.
+        """
+        return self.device.set_auto_report(interval)
+
     def send_home(self, x: bool, y: bool, z: bool) -> None:
         """Moving individual axis back to home positions"""
         return self.device.send_home(x, y, z)
@@ -134,15 +211,26 @@ class GCoderDevice(HWBaseInstance):
             "get_speed",
             "get_settings",
             "in_motion",
+            "report_count",
         ]
 
+    @property
+    def stream_methods(self) -> Dict[str, str]:
+        # Position is updated by the gantry auto-report in the background
+        return {"position": "get_current_coord"}
+
     @property
     def operation_methods(self) -> List[str]:
         return [
             "reset_devices",
             "run_gcode",
+            "run_gcode_batch",
             "set_speed_limit",
             "move_to",
+            "move_to_and_wait",
+            "wait_motion",
+            "run_trajectory",
+            "set_auto_report",
             "send_home",
             "enable_stepper",
             "disable_stepper",
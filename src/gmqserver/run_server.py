@@ -18,6 +18,7 @@ from SenAUX_methods import SenAUXDevice
 from zmq_server import (
     HWControlServer,
     make_cmd_parser,
+    make_zmq_pub_socket,
     make_zmq_server_socket,
     parse_cmd_args,
 )
@@ -38,6 +39,14 @@ if __name__ == "__main__":
     socket = make_zmq_server_socket(port=config["port"])
     logger = logging.getLogger("gmqserver@default")
 
+    # Data streams are only published if explicitly configured
+    stream_config = config.get("stream", {})
+    pub_socket = (
+        make_zmq_pub_socket(stream_config["port"], stream_config.get("hwm", 16))
+        if "port" in stream_config
+        else None
+    )
+
     server = HWControlServer(
         socket=socket,
         logger=logger,
@@ -49,6 +58,8 @@ if __name__ == "__main__":
             SenAUXDevice("senaux", logger),
             RigolPS("rigol", logger),
         ],
+        pub_socket=pub_socket,
+        stream_rates=stream_config.get("rates", {}),
     )
 
     # Initializing interfaces defined in the configurations file
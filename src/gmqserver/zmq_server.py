@@ -1,12 +1,22 @@
 import argparse
 import collections
+import contextlib
 import json
 import logging
-import pickle
-from typing import Any, Dict, List, Optional, Tuple
+import operator
+import os
+import queue
+import threading
+import time
+from typing import Any, Dict, List, Optional, Set, Tuple
 
 import zmq
 
+if "GMQPACKAGE_IS_CLIENT" not in os.environ:
+    import zmq_wire
+else:
+    from gmqclient.server import zmq_wire
+
 
 def _collapse_str_(x: str):
     return " ".join(x.split())
@@ -14,7 +24,20 @@ def _collapse_str_(x: str):
 
 def make_zmq_server_socket(port: int) -> zmq.Socket:
     context = zmq.Context()
-    socket = context.socket(zmq.REP)
+    socket = context.socket(zmq.ROUTER)
+    socket.bind(f"tcp://*:{port}")
+    return socket
+
+
+def make_zmq_pub_socket(port: int, hwm: int = 16) -> zmq.Socket:
+    """
+    Socket used for publishing the data streams. The high-water mark is the
+    number of messages that can be queued for each subscriber, further messages
+    are dropped for slow subscribers.
+    """
+    context = zmq.Context()
+    socket = context.socket(zmq.PUB)
+    socket.setsockopt(zmq.SNDHWM, hwm)
     socket.bind(f"tcp://*:{port}")
     return socket
 
@@ -24,15 +47,46 @@ class MemHandler(logging.Handler):
     Storing logging records in memory using a first-in-first-out scheme, to be
     re-emitted later. We are expecting that the record list is routinely
     monitored and will not be keeping a persistent copy.
+
+    Records emitted by a thread while it is processing a request (see the
+    `capture` method) are stored separately, such that they can be returned to
+    the client that made the request. Records emitted outside of requests (by
+    background threads, for example) are stored in the common record list.
     """
 
     def __init__(self, capacity: int, level: int = logging.NOTSET):
         super().__init__(level=level)
+        self.capacity = capacity
         self.record_list = collections.deque([], maxlen=capacity)
+        self._captures: Dict[int, collections.deque] = {}
 
     def emit(self, record):
         """Main method that needs overloading"""
-        self.record_list.append(record)
+        self._captures.get(threading.get_ident(), self.record_list).append(record)
+
+    @contextlib.contextmanager
+    def capture(self):
+        """
+        Context where all records emitted by the current thread are stored in
+        the yielded container instead of the common record list. Contexts can
+        be nested, with records only stored by the innermost context.
+        """
+        ident = threading.get_ident()
+        previous = self._captures.get(ident)
+        records = collections.deque([], maxlen=self.capacity)
+        self._captures[ident] = records
+        try:
+            yield records
+        finally:
+            if previous is None:
+                del self._captures[ident]
+            else:
+                self._captures[ident] = previous
+
+    def extend(self, records: List[logging.LogRecord]):
+        """Adding records as if they were emitted by the current thread"""
+        for record in records:
+            self.emit(record)
 
 
 class HWBaseInstance(object):
@@ -44,7 +98,8 @@ class HWBaseInstance(object):
         self.name = name
         self.logger = logger
 
-        for method in self.all_telemetry_methods + self.all_operation_methods:
+        methods = self.all_telemetry_methods + self.all_operation_methods
+        for method in methods + list(self.stream_methods.values()):
             assert hasattr(self, method), (
                 "Hardware control class ["
                 + self.__class__.__name__
@@ -92,6 +147,17 @@ class HWBaseInstance(object):
         """
         return []
 
+    @property
+    def stream_methods(self) -> Dict[str, str]:
+        """
+        Mapping of stream names to methods (without arguments) whose return
+        values can be periodically published by the server. These methods are
+        called by a separate thread from the requests, so they should only
+        read values that are safe to access concurrently (ex: values sampled in
+        the background). A return value of None is not published.
+        """
+        return {}
+
     @property
     def all_telemetry_methods(self) -> List[str]:
         return self.telemetry_methods + ["is_initialized", "is_dummy"]
@@ -101,12 +167,214 @@ class HWBaseInstance(object):
         return self.operation_methods
 
 
+class HWReply(object):
+    """
+    Reply to a received message. A message contains either a single request,
+    or a batch of requests whose responses are returned together in a single
+    reply once all requests in the batch are processed. As the requests in a
+    batch may be processed by different worker threads, the responses are
+    collected under a lock.
+    """
+
+    drain_messages = True
+
+    def __init__(self, envelope: List[Any], n: int, batch: bool):
+        self.envelope = envelope
+        self.batch = batch
+        self.responses: List[Optional[Dict[str, Any]]] = [None] * n
+        self.remaining = n
+        self.lock = threading.Lock()
+
+    def set(self, index: int, response: Dict[str, Any]) -> Optional[List[Any]]:
+        """
+        Storing the response of a request, returns the frames to send once the
+        responses of all requests are available, None otherwise.
+        """
+        with self.lock:
+            self.responses[index] = response
+            self.remaining = self.remaining - 1
+            if self.remaining > 0:
+                return None
+        message = {"batch": self.responses} if self.batch else self.responses[0]
+        try:
+            return self.envelope + zmq_wire.dumps(message)
+        except TypeError as err:
+            # Return value that cannot be sent, reported as a failure of the
+            # whole message
+            messages = [x for r in self.responses for x in r["messages"]]
+            message = {"messages": messages, "exception": err}
+            return self.envelope + zmq_wire.dumps(message)
+
+
+class HWStepReply(object):
+    """
+    Reply to a request submitted to a worker from within the server, the
+    response is passed to the waiting thread instead of being sent. Records
+    emitted outside of requests are not included in the response, these are
+    left to be returned with the next reply sent to a client.
+    """
+
+    drain_messages = False
+
+    def __init__(self):
+        self.event = threading.Event()
+        self.response: Optional[Dict[str, Any]] = None
+
+    def set(self, index: int, response: Dict[str, Any]) -> None:
+        self.response = response
+        self.event.set()
+
+    def wait(self) -> Dict[str, Any]:
+        self.event.wait()
+        return self.response
+
+
+class HWWorker(object):
+    """
+    Thread for running the requests of a single hardware instance in the order
+    that they are received. Calls to the same hardware instance are therefore
+    always serialized, while calls to different hardware instances can run
+    concurrently. As ZMQ sockets cannot be shared between threads, the encoded
+    replies are passed back to the dispatching thread via an inproc socket.
+    """
+
+    def __init__(self, server: "HWControlServer", name: str):
+        self.server = server
+        self.queue: queue.Queue = queue.Queue()
+        self.thread = threading.Thread(
+            target=self.run, name=f"gmq-worker-{name}", daemon=True
+        )
+        self.thread.start()
+
+    def submit(self, reply: HWReply, index: int, request: Dict[str, Any]) -> None:
+        self.queue.put((reply, index, request))
+
+    def stop(self) -> None:
+        self.queue.put(None)
+        self.thread.join()
+
+    def run(self) -> None:
+        socket = self.server.socket.context.socket(zmq.PUSH)
+        socket.connect(self.server.reply_address)
+        while True:
+            item = self.queue.get()
+            if item is None:
+                break
+            reply, index, request = item
+            response = self.server.process_request(request, reply.drain_messages)
+            frames = reply.set(index, response)
+            if frames is not None:
+                socket.send_multipart(frames, copy=False)
+        socket.close()
+
+
+class HWBatchThread(object):
+    """
+    Short-lived thread running a single run_batch request. As a batch can wait
+    on a device for a long time, each batch runs on its own thread, such that
+    the batch of one client does not block the batches of the other clients.
+    The reply is passed back to the dispatching thread like the worker replies.
+    """
+
+    def __init__(self, server: "HWControlServer"):
+        self.server = server
+        self.thread: Optional[threading.Thread] = None
+
+    def submit(self, reply: HWReply, index: int, request: Dict[str, Any]) -> None:
+        with self.server.batch_lock:
+            self.server.batches.add(self)
+        self.thread = threading.Thread(
+            target=self.run,
+            args=(reply, index, request),
+            name="gmq-batch",
+            daemon=True,
+        )
+        self.thread.start()
+
+    def run(self, reply: HWReply, index: int, request: Dict[str, Any]) -> None:
+        socket = self.server.socket.context.socket(zmq.PUSH)
+        socket.connect(self.server.reply_address)
+        try:
+            frames = reply.set(index, self.server.process_request(request))
+            if frames is not None:
+                socket.send_multipart(frames, copy=False)
+        finally:
+            socket.close()
+            with self.server.batch_lock:
+                self.server.batches.discard(self)
+
+
+class HWStream(object):
+    """
+    Thread periodically calling a stream method of a hardware instance, the
+    results are passed to the dispatching thread via an inproc socket to be
+    published under the stream topic.
+    """
+
+    def __init__(self, server: "HWControlServer", topic: str, rate: float):
+        hw_name, stream = topic.split(".", 1)
+        hw = server.hw_instance(hw_name)
+        assert stream in hw.stream_methods, f"Unknown stream [{topic}]"
+        assert rate > 0, f"Stream rate for [{topic}] must be positive"
+        self.server = server
+        self.topic = topic
+        self.rate = rate
+        self.method = getattr(hw, hw.stream_methods[stream])
+        self.stop_event = threading.Event()
+        self.thread: Optional[threading.Thread] = None
+
+    def start(self) -> None:
+        self.stop_event.clear()
+        self.thread = threading.Thread(
+            target=self.run, name=f"gmq-stream-{self.topic}", daemon=True
+        )
+        self.thread.start()
+
+    def stop(self) -> None:
+        self.stop_event.set()
+        self.thread.join()
+
+    def run(self) -> None:
+        socket = self.server.socket.context.socket(zmq.PUSH)
+        socket.connect(self.server.stream_address)
+        failed = False
+        next_time = time.monotonic()
+        while not self.stop_event.wait(max(0, next_time - time.monotonic())):
+            # Skipping missed updates rather than trying to catch up
+            next_time = max(next_time + 1.0 / self.rate, time.monotonic())
+            try:
+                data = self.method()
+                if data is not None:
+                    message = zmq_wire.dumps({"time": time.time(), "data": data})
+                    topic = self.topic.encode()
+                    socket.send_multipart([topic] + message, copy=False)
+                failed = False
+            except Exception as err:
+                # Only logging the first failure of a sequence of failures
+                if not failed:
+                    self.server.logger.warning(f"Stream [{self.topic}] failed: {err}")
+                failed = True
+        socket.close()
+
+
 class HWControlServer(object):
     """
     The main server instance that parses the hardware control request from the
     client side to functions calls of the various hardware control classes
     instances. This method also centrally handles the logging, to ensure all
     messages that appears server side will be emitted to the client.
+
+    Requests are received on a ROUTER socket by a single dispatching thread.
+    Requests for a hardware instance are passed to the worker thread of the
+    instance, such that a long operation on one hardware instance (ex: homing
+    the gantry) does not block requests to the other instances. Special
+    functions that do not target a hardware instance are processed directly by
+    the dispatching thread, except for run_batch, which is processed by a
+    short-lived thread for each request.
+
+    If a PUB socket is given, the stream methods of the hardware instances
+    listed in stream_rates (as "<hw_name>.<stream>": rate in Hz) are published
+    on the PUB socket, with the topic as the first frame of the message.
     """
 
     def __init__(
@@ -114,11 +382,28 @@ class HWControlServer(object):
         socket: zmq.Socket,
         logger: logging.Logger,
         hw_list: List[HWBaseInstance],
+        pub_socket: Optional[zmq.Socket] = None,
+        stream_rates: Optional[Dict[str, float]] = None,
     ):
         # Storing the socket instance to be used
         self.socket = socket
         # ID to keep track of which client assumes control
         self._operator_id: Optional[str] = None
+        self._operator_lock = threading.RLock()
+
+        # Socket used by the worker threads to return the responses
+        self.reply_address = f"inproc://gmq-reply-{id(self)}"
+        self.reply_socket = self.socket.context.socket(zmq.PULL)
+        self.reply_socket.bind(self.reply_address)
+        self.workers: Dict[str, HWWorker] = {}
+        self.batches: Set[HWBatchThread] = set()
+        self.batch_lock = threading.Lock()
+
+        # Socket used by the stream threads to return the data to be published
+        self.stream_address = f"inproc://gmq-stream-{id(self)}"
+        self.stream_socket = self.socket.context.socket(zmq.PULL)
+        self.stream_socket.bind(self.stream_address)
+        self.pub_socket = pub_socket
 
         # Storing the logger instance to be used
         self.logger = logger
@@ -136,28 +421,37 @@ class HWControlServer(object):
         )
         assert len(_check) == len(self.hw_list), "Duplicate hardware name!" + _hw_name
 
+        # Streams can only be declared once the hardware list is known
+        stream_rates = {} if stream_rates is None else stream_rates
+        assert pub_socket is not None or not stream_rates, "Missing PUB socket!"
+        self.streams = [HWStream(self, k, v) for k, v in stream_rates.items()]
+
     def run_single_request(
         self,
         client_id: str,
         hw_name: str,
         function_name: str,
-        args=Tuple[Any],
-        kwargs=Dict[str, Any],
-    ) -> None:
-        def return_response(ret: Any) -> None:
-            self.socket.send(
-                pickle.dumps({"messages": self.clear_message(), "return": ret})
-            )
+        args: Tuple[Any] = (),
+        kwargs: Optional[Dict[str, Any]] = None,
+    ) -> Any:
+        """
+        Running a single request, returning the return value of the requested
+        function. May be called concurrently by the worker threads of
+        different hardware instances.
+        """
+        kwargs = {} if kwargs is None else kwargs
 
         # Handling special functions
         if function_name == "is_operator":
-            return return_response(client_id == self._operator_id)
+            return client_id == self._operator_id
         if function_name == "claim_operator":
-            return return_response(
-                self.claim_operator(client_id, error_if_claimed=False)
-            )
+            return self.claim_operator(client_id, error_if_claimed=False)
         if function_name == "release_operator":
-            return return_response(self.release_operator(client_id))
+            return self.release_operator(client_id)
+        if function_name == "stream_info":
+            return self.stream_info()
+        if function_name == "run_batch":
+            return self.run_batch(client_id, *args, **kwargs)
 
         # Finding hw_instance to that should be used.
         hw = self.hw_instance(hw_name)
@@ -168,46 +462,220 @@ class HWControlServer(object):
         ), f"Hardware <{hw.name}({type(hw)})> is not initialized"
         if function_name in hw.all_telemetry_methods:
             method = getattr(hw, function_name)
-            return return_response(method(*args, **kwargs))
+            return method(*args, **kwargs)
         if function_name in hw.all_operation_methods:
             self.claim_operator(client_id, error_if_claimed=True)
             method = getattr(hw, function_name)
-            return return_response(method(*args, **kwargs))
+            return method(*args, **kwargs)
         # Returning default if not recognized
         raise RuntimeError(
             f"Function <{function_name}> of hardware <{hw.name}({type(hw)})> not recognized!"
         )
 
-    def run_server(self):
-        while True:
-            # Always assume that the code can be decoded using method
-            request = self.socket.recv()
+    def process_request(
+        self, request: Dict[str, Any], drain_messages: bool = True
+    ) -> Dict[str, Any]:
+        """
+        Running a decoded request, returning the response to be sent. Log
+        records emitted while running the request are returned together with
+        the records emitted outside of requests, unless drain_messages is
+        False, in which case the latter are kept in the common record list.
+        """
+        with self.mem_handle.capture() as records:
             try:
-                request = pickle.loads(request)
                 self.logger.info(request)
-                self.run_single_request(**request)
-            except KeyboardInterrupt or InterruptedError:
-                # Allow keyboard interaction and stop signals to interrupt
-                # server operation
-                break
-            # Additional exceptions that should terminate hardware control??
+                response = {"return": self.run_single_request(**request)}
             except Exception as err:
                 # Sending error message back to client
-                self.socket.send(
-                    pickle.dumps({"messages": self.clear_message(), "exception": err})
+                response = {"exception": err}
+        background = self.clear_message() if drain_messages else []
+        response["messages"] = background + list(records)
+        return response
+
+    def dispatch(self, frames: List[Any]) -> None:
+        """
+        Passing the requests of a received message to the workers of the
+        requested hardware instances. The envelope of the message (the client
+        identity frames up to the empty delimiter frame) is kept to route the
+        reply. Requests of a batch targeting different hardware instances may
+        run concurrently.
+        """
+        n = next((i + 1 for i, x in enumerate(frames) if len(x) == 0), 1)
+        envelope, body = frames[:n], frames[n:]
+        try:
+            message = zmq_wire.loads(body)
+            requests = message["batch"] if "batch" in message else [message]
+            reply = HWReply(envelope, len(requests), "batch" in message)
+            workers = [self.request_worker(x) for x in requests]
+        except Exception as err:
+            response = {"messages": self.clear_message(), "exception": err}
+            return self.socket.send_multipart(
+                envelope + zmq_wire.dumps(response), copy=False
+            )
+        if len(requests) == 0:
+            return self.socket.send_multipart(
+                envelope + zmq_wire.dumps({"batch": []}), copy=False
+            )
+        for index, (request, worker) in enumerate(zip(requests, workers)):
+            if worker is not None:
+                worker.submit(reply, index, request)
+                continue
+            # Special functions and unknown hardware instances
+            reply_frames = reply.set(index, self.process_request(request))
+            if reply_frames is not None:
+                self.socket.send_multipart(reply_frames, copy=False)
+
+    def request_worker(self, request: Dict[str, Any]) -> Any:
+        """Worker processing the request, None for the dispatching thread"""
+        if request.get("function_name") == "run_batch":
+            return HWBatchThread(self)
+        return self.workers.get(request.get("hw_name"))
+
+    def run_batch(
+        self, client_id: str, steps: List[Any], interval: float = 0.05
+    ) -> List[Any]:
+        """
+        Running a sequence of function calls server side in a single request,
+        returning the list of return values. Each step is either a
+        (hw_name, function_name, args, kwargs) sequence (args and kwargs can be
+        omitted), or a dictionary with the same keys. A dictionary step can
+        also contain an "until" entry, making it a wait step:
+
+            {"value": False, "compare": "==", "timeout": 30}
+
+        Where the function is called repeatedly (every interval seconds) until
+        the comparison of the return value with the given value is true, or
+        raising a TimeoutError when the timeout (in seconds) is exceeded.
+
+        Each call is processed by the worker of the hardware instance, so steps
+        are interleaved with requests from other clients. Processing stops at
+        the first failed step, with the error raised for the whole batch.
+        """
+        results = []
+        for index, step in enumerate(steps):
+            if not isinstance(step, dict):
+                step = dict(zip(["hw_name", "function_name", "args", "kwargs"], step))
+            name = f"{step['hw_name']}.{step['function_name']}"
+            try:
+                assert step["function_name"] != "run_batch", "Cannot nest run_batch"
+                request = dict(
+                    client_id=client_id,
+                    hw_name=step["hw_name"],
+                    function_name=step["function_name"],
+                    args=tuple(step.get("args", ())),
+                    kwargs=step.get("kwargs", {}),
                 )
-            finally:
-                pass
+                if "until" in step:
+                    results.append(self._wait_step(request, step["until"], interval))
+                else:
+                    results.append(self._run_step(request, logging.NOTSET))
+            except Exception as err:
+                message = f"Batch step {index} [{name}] failed: {err}"
+                raise RuntimeError(message) from err
+        return results
+
+    def _run_step(self, request: Dict[str, Any], level: int) -> Any:
+        """
+        Running a batch step in the worker of the hardware instance, only log
+        records emitted by the step at or above the given level are kept.
+        """
+        worker = self.workers.get(request["hw_name"])
+        if worker is not None:
+            reply = HWStepReply()
+            worker.submit(reply, 0, request)
+            response = reply.wait()
+        else:
+            response = self.process_request(request, drain_messages=False)
+        self.mem_handle.extend([x for x in response["messages"] if x.levelno >= level])
+        if "exception" in response:
+            raise response["exception"]
+        return response["return"]
+
+    def _wait_step(
+        self, request: Dict[str, Any], until: Dict[str, Any], interval: float
+    ) -> Any:
+        compare = {
+            "==": operator.eq,
+            "!=": operator.ne,
+            "<": operator.lt,
+            "<=": operator.le,
+            ">": operator.gt,
+            ">=": operator.ge,
+        }[until.get("compare", "==")]
+        deadline = time.monotonic() + until.get("timeout", 60)
+        while True:
+            # Only keeping warnings from the repeated calls
+            ret = self._run_step(request, logging.WARNING)
+            if compare(ret, until["value"]):
+                return ret
+            if time.monotonic() > deadline:
+                raise TimeoutError(f"Last return value: {ret}")
+            time.sleep(interval)
+
+    def run_server(self):
+        self.workers = {x.name: HWWorker(self, x.name) for x in self.hw_list}
+        for stream in self.streams:
+            stream.start()
+        poller = zmq.Poller()
+        poller.register(self.socket, zmq.POLLIN)
+        poller.register(self.reply_socket, zmq.POLLIN)
+        poller.register(self.stream_socket, zmq.POLLIN)
+        try:
+            while True:
+                events = dict(poller.poll())
+                if self.reply_socket in events:
+                    reply = self.reply_socket.recv_multipart(copy=False)
+                    self.socket.send_multipart(reply, copy=False)
+                if self.stream_socket in events:
+                    message = self.stream_socket.recv_multipart(copy=False)
+                    self.pub_socket.send_multipart(message, copy=False)
+                if self.socket in events:
+                    self.dispatch(self.socket.recv_multipart(copy=False))
+        except (KeyboardInterrupt, InterruptedError):
+            # Allow keyboard interaction and stop signals to interrupt server
+            # operation. Requests being processed are allowed to finish.
+            pass
+        finally:
+            for stream in self.streams:
+                stream.stop()
+            # Batches must finish first, as they wait on the other workers
+            with self.batch_lock:
+                batches = list(self.batches)
+            for batch in batches:
+                batch.thread.join()
+            for worker in self.workers.values():
+                worker.stop()
+            self.workers = {}
+
+    def stream_info(self) -> Dict[str, Any]:
+        """
+        Port of the PUB socket (None if streams are not published), and the
+        publishing rates of the streams in Hz.
+        """
+        if self.pub_socket is None:
+            return {"port": None, "rates": {}}
+        endpoint = self.pub_socket.getsockopt_string(zmq.LAST_ENDPOINT)
+        return {
+            "port": int(endpoint.rsplit(":", 1)[1]),
+            "rates": {x.topic: x.rate for x in self.streams},
+        }
 
     def clear_message(self) -> List[logging.LogRecord]:
-        return_list = [x for x in self.mem_handle.record_list]
-        self.mem_handle.record_list.clear()
-        return return_list
+        return_list = []
+        try:
+            while True:
+                return_list.append(self.mem_handle.record_list.popleft())
+        except IndexError:
+            return return_list
 
     def claim_operator(self, client_id: str, error_if_claimed: bool = False) -> None:
         """
         Setting client of id_string to be the unquie identifier
         """
+        with self._operator_lock:
+            self._claim_operator(client_id, error_if_claimed)
+
+    def _claim_operator(self, client_id: str, error_if_claimed: bool) -> None:
         if self._operator_id is None:
             self.logger.info(f"Claiming operation with ID {client_id}")
         elif self._operator_id != client_id:
@@ -235,6 +703,10 @@ class HWControlServer(object):
         self._operator_id = client_id
 
     def release_operator(self, client_id: str):
+        with self._operator_lock:
+            self._release_operator(client_id)
+
+    def _release_operator(self, client_id: str):
         if self._operator_id is not None and self._operator_id != client_id:
             raise RuntimeError(
                 _collapse_str_(
@@ -298,7 +770,7 @@ if __name__ == "__main__":
 
     class DummyHW(HWBaseInstance):
         def __init__(self, name, logger):
-            super().__init__(name)
+            super().__init__(name, logger)
             self.counter = 0
 
         def check_counter(self, logger: logging.Logger):
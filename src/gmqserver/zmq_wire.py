@@ -0,0 +1,236 @@
+"""
+Wire format used for the ZMQ request/response messages between the server and
+the client.
+
+Each message is sent as a multipart ZMQ message: the first frame is a small
+JSON header describing the message content, and each binary buffer (numpy
+arrays and bytes objects) found in the message is sent as-is as an additional
+frame. This avoids serializing the large data buffers (waveforms, camera
+frames) through pickle, and with `copy=False` the buffers are passed to ZMQ
+without being copied on the sending side. On the receiving side, arrays are
+reconstructed as read-only views over the received frames, use `numpy.copy`
+if the array needs to be modified.
+
+Types that have no natural JSON representation are stored as tagged objects
+(dictionaries containing the `__gmq__` key). Objects of other types cannot be
+sent and raise a TypeError. In particular, nothing is ever unpickled, so a
+message cannot cause arbitrary code to run on the receiving side.
+"""
+
+import builtins
+import json
+import logging
+import time
+from typing import Any, List
+
+import numpy
+import zmq
+
+# Key used for marking tagged objects in the JSON header
+_TAG = "__gmq__"
+
+# Attributes of the log records that are passed to the client. The message is
+# always formatted server side, so arbitrary message arguments are not passed.
+_RECORD_ATTRS = [
+    "name",
+    "levelno",
+    "levelname",
+    "pathname",
+    "filename",
+    "module",
+    "lineno",
+    "funcName",
+    "created",
+    "msecs",
+    "relativeCreated",
+    "thread",
+    "threadName",
+    "process",
+    "processName",
+    "exc_text",
+    "stack_info",
+]
+
+
+class RemoteError(RuntimeError):
+    """
+    Exception raised client side for server side exceptions that do not have
+    an equivalent built-in exception type.
+    """
+
+    pass
+
+
+def _encode(obj: Any, frames: List[Any]) -> Any:
+    """
+    Converting an object to a JSON compatible object, with the binary buffers
+    appended to the frame list.
+    """
+    if obj is None or isinstance(obj, (bool, int, float, str)):
+        return obj
+    if isinstance(obj, list):
+        return [_encode(x, frames) for x in obj]
+    if isinstance(obj, dict):
+        if all(isinstance(k, str) for k in obj.keys()) and _TAG not in obj:
+            return {k: _encode(v, frames) for k, v in obj.items()}
+        return {
+            _TAG: "dict",
+            "items": [_encode([k, v], frames) for k, v in obj.items()],
+        }
+    if isinstance(obj, tuple):
+        return {_TAG: "tuple", "items": [_encode(x, frames) for x in obj]}
+    if isinstance(obj, numpy.ndarray) and not obj.dtype.hasobject:
+        frames.append(numpy.ascontiguousarray(obj))
+        return {
+            _TAG: "ndarray",
+            "dtype": obj.dtype.str,
+            "shape": list(obj.shape),
+            "frame": len(frames) - 1,
+        }
+    if isinstance(obj, numpy.generic) and not isinstance(obj, numpy.object_):
+        return obj.item()
+    if isinstance(obj, (bytes, bytearray, memoryview)):
+        frames.append(obj)
+        return {_TAG: "bytes", "frame": len(frames) - 1}
+    if isinstance(obj, logging.LogRecord):
+        record = {x: getattr(obj, x, None) for x in _RECORD_ATTRS}
+        record["msg"] = obj.getMessage()
+        return {_TAG: "log", "record": _encode(record, frames)}
+    if isinstance(obj, BaseException):
+        return {
+            _TAG: "exception",
+            "type": type(obj).__name__,
+            "module": type(obj).__module__,
+            "message": str(obj),
+            "args": _encode(list(obj.args), frames),
+        }
+    raise TypeError(f"Object of type [{type(obj).__name__}] cannot be sent")
+
+
+def _decode(obj: Any, frames: List[memoryview]) -> Any:
+    """Inverse of the _encode method."""
+    if isinstance(obj, list):
+        return [_decode(x, frames) for x in obj]
+    if not isinstance(obj, dict):
+        return obj
+    if _TAG not in obj:
+        return {k: _decode(v, frames) for k, v in obj.items()}
+
+    tag = obj[_TAG]
+    if tag == "dict":
+        return {k: v for k, v in _decode(obj["items"], frames)}
+    if tag == "tuple":
+        return tuple(_decode(obj["items"], frames))
+    if tag == "ndarray":
+        return numpy.frombuffer(
+            frames[obj["frame"]], dtype=numpy.dtype(obj["dtype"])
+        ).reshape(obj["shape"])
+    if tag == "bytes":
+        return bytes(frames[obj["frame"]])
+    if tag == "log":
+        record = _decode(obj["record"], frames)
+        record["args"] = None
+        return logging.makeLogRecord(record)
+    if tag == "exception":
+        return _make_exception(obj, _decode(obj["args"], frames))
+    raise ValueError(f"Unknown object tag [{tag}] in message")
+
+
+def _make_exception(obj: dict, args: List[Any]) -> BaseException:
+    """
+    Reconstructing the exception. Built-in exception types are reconstructed
+    as is, all other exceptions are raised as RemoteError with the original
+    type name in the message.
+    """
+    exc_type = getattr(builtins, obj["type"], None)
+    if (
+        obj["module"] == "builtins"
+        and isinstance(exc_type, type)
+        and issubclass(exc_type, Exception)
+    ):
+        try:
+            return exc_type(*args)
+        except Exception:
+            pass
+    return RemoteError(f"{obj['module']}.{obj['type']}: {obj['message']}")
+
+
+def dumps(obj: Any) -> List[Any]:
+    """
+    Converting an object to the list of frames to be sent as a multipart
+    message. The buffer frames reference the memory of the original objects,
+    which should not be modified until the message is sent.
+    """
+    frames = []
+    header = _encode(obj, frames)
+    return [json.dumps(header, separators=(",", ":")).encode("utf-8")] + frames
+
+
+def loads(frames: List[Any]) -> Any:
+    """
+    Reconstructing the object from the list of received frames. Frames can
+    either be zmq.Frame objects (received with `copy=False`) or bytes.
+    """
+    buffers = [
+        x.buffer if isinstance(x, zmq.Frame) else memoryview(x) for x in frames
+    ]
+    return _decode(json.loads(bytes(buffers[0])), buffers[1:])
+
+
+def send(socket: zmq.Socket, obj: Any) -> None:
+    """Sending an object over the socket in the multipart format."""
+    socket.send_multipart(dumps(obj), copy=False)
+
+
+def recv(socket: zmq.Socket) -> Any:
+    """Receiving an object sent by the send method."""
+    return loads(socket.recv_multipart(copy=False))
+
+
+if __name__ == "__main__":
+    # Throughput benchmark of a round trip for a REQ/REP socket pair, comparing
+    # the pickle based messages with the multipart messages.
+    import pickle
+    import threading
+
+    context = zmq.Context()
+    rep = context.socket(zmq.REP)
+    port = rep.bind_to_random_port("tcp://127.0.0.1")
+    req = context.socket(zmq.REQ)
+    req.connect(f"tcp://127.0.0.1:{port}")
+
+    def echo_server():
+        while True:
+            frames = rep.recv_multipart(copy=False)
+            if len(frames) == 1 and frames[0].bytes == b"stop":
+                rep.send(b"")
+                break
+            rep.send_multipart(frames, copy=False)
+
+    def run_pickle(x: Any) -> Any:
+        req.send(pickle.dumps({"messages": [], "return": x}))
+        return pickle.loads(req.recv())["return"]
+
+    def run_wire(x: Any) -> Any:
+        send(req, {"messages": [], "return": x})
+        return recv(req)["return"]
+
+    thread = threading.Thread(target=echo_server)
+    thread.start()
+
+    print(f"{'size':>10s} {'pickle [MB/s]':>14s} {'multipart [MB/s]':>17s}")
+    for size in [1000, 10000, 100000, 1000000, 10000000]:
+        x = numpy.random.randint(0, 255, size=size, dtype=numpy.uint8)
+        n = max(10, min(1000, 100000000 // size))
+        rates: List[float] = []
+        for method in [run_pickle, run_wire]:
+            assert numpy.array_equal(method(x), x)
+            start = time.perf_counter()
+            for _ in range(n):
+                method(x)
+            rates.append(size * n / (time.perf_counter() - start) / 1e6)
+        print(f"{size:>10d} {rates[0]:>14.1f} {rates[1]:>17.1f}")
+
+    req.send(b"stop")
+    req.recv()
+    thread.join()
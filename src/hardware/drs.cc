@@ -28,22 +28,51 @@
  */
 
 // Custom short hand directories
+#include "spsc_ring.hpp"
 #include "sysfs.hpp"
 #include "threadsleep.hpp"
 
-// DRS library
-#include "DRS.h"
+// DRS library, or the simulated board for testing
+#ifdef GMQ_DRS_MOCK
+  #include "drs_mock.hpp"
+#else
+  #include "DRS.h"
+#endif
 
 // Standard C++ libraries
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
 #include <fmt/core.h>
 #include <fstream>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <vector>
 
+// SIMD intrinsics for the waveform summation
+#if defined( __AVX2__ )
+  #include <immintrin.h>
+#elif defined( __ARM_NEON ) && defined( __aarch64__ )
+  #include <arm_neon.h>
+#endif
+
 // For python binding
 #include <pybind11/numpy.h>
 #include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
+
+static double window_sum( const float*    waveform,
+                          const unsigned maxlen,
+                          const unsigned intstart,
+                          const unsigned intstop,
+                          const unsigned pedstart,
+                          const unsigned pedstop,
+                          const double   timeslice );
+static double sample_sum( const float* x, const unsigned begin, const unsigned end );
 
 class DRSContainer : private hw::fd_accessor
 {
@@ -62,25 +91,41 @@ public:
   void SetSamples( const unsigned );
 
   // Direct interfaces
+  pybind11::array_t<float> CollectEvents( const unsigned n, const std::vector<unsigned>& channels, const unsigned timeout = 0 );
   pybind11::array_t<float> GetWaveform( const unsigned channel );
+  pybind11::array_t<float> GetWaveformInto( const unsigned channel, pybind11::array_t<float> out );
   pybind11::array_t<float> GetTimeArray( const unsigned channel );
 
+  // Continuous acquisition
+  void                     StartContinuous( const std::vector<unsigned>& channels, const unsigned capacity = 1024 );
+  void                     StopContinuous();
+  pybind11::array_t<float> DrainEvents( const unsigned max_events, const unsigned timeout = 0 );
+  bool                     IsContinuous() const { return continuous_run; }
+  size_t                   RingOccupancy() const { return ring ? ring->size() : 0; }
+  uint64_t                 DroppedEvents() const { return dropped_events; }
+  uint64_t                 CollectedEvents() const { return collected_events; }
+  pybind11::tuple          LatestEvent();
+
   // High level interfaces
   double   WaveformSum( const unsigned channel,
                         const unsigned intstart = -1,
                         const unsigned intstop  = -1,
                         const unsigned pedstart = -1,
                         const unsigned pedstop  = -1 );
+  pybind11::array_t<double> WaveformSums( const unsigned                              n,
+                                          const std::vector<unsigned>&                channels,
+                                          const std::vector<std::array<unsigned, 4>>& windows,
+                                          const unsigned                              timeout = 0 );
   void     RunCalib();
   int      TriggerChannel();
   int      TriggerDirection();
   double   TriggerDelay();
   double   TriggerLevel();
-  double   GetRate();
+  double   GetRate() const;
   unsigned GetSamples();
 
   // Pausing functions
-  void WaitReady();
+  bool WaitReady( const unsigned timeout = 0 );
   bool IsAvailable() const;
   bool IsReady();
   void CheckAvailable() const;
@@ -94,14 +139,37 @@ private:
   DRSBoard*            board;
 
   // Time samples
+  double   rate; /** Cached value of the true sampling rate */
   double   triggerlevel;
   unsigned triggerchannel;
   int      triggerdirection;
   double   triggerdelay;
   unsigned samples;
 
-  std::vector<float> GetWaveFormRaw( const unsigned channel );
-  std::vector<float> GetTimeArrayRaw( const unsigned channel );
+  // Persistent per-channel waveform buffers
+  static constexpr unsigned              nchannels     = 4;
+  static constexpr unsigned              buffer_length = 2048;
+  std::array<std::shared_ptr<float>, 4> wavebuffer;
+
+  const std::shared_ptr<float>& GetWaveFormRaw( const unsigned channel );
+  std::vector<float>            GetTimeArrayRaw( const unsigned channel );
+  static std::shared_ptr<float> make_wavebuffer();
+
+  // Continuous acquisition producer thread and event ring
+  std::thread                          producer;
+  std::atomic<bool>                    continuous_run;
+  std::atomic<uint64_t>                dropped_events;
+  std::atomic<uint64_t>                collected_events;
+  std::unique_ptr<hw::spsc_ring<float>> ring;
+  std::vector<unsigned>                ring_channels;
+  unsigned                             ring_samples;
+  std::mutex                           consumer_mutex; /** Only a single consumer is allowed */
+  std::vector<float>                   latest_event;   /** Copy of the latest event for monitoring */
+  uint64_t                             latest_seq;
+  std::mutex                           latest_mutex;
+
+  void producer_loop();
+  void UpdateRate();
 
   static std::string make_lockfile();
 };
@@ -120,6 +188,14 @@ DRSContainer::DRSContainer()
   hw::fd_accessor( "DRS", make_lockfile(), hw::fd_accessor::MODE::READ_WRITE )
   , drs( nullptr )
   , board( nullptr )
+  , rate( 0 )
+  , samples( buffer_length )
+  , continuous_run( false )
+  , dropped_events( 0 )
+  , collected_events( 0 )
+  , ring( nullptr )
+  , ring_samples( 0 )
+  , latest_seq( 0 )
 {
   printdebug( "Setting up DRS devices..." );
   char str[256];
@@ -147,6 +223,7 @@ DRSContainer::DRSContainer()
   // Running the various common settings required for the SiPM calibration
   // board->SetChannelConfig( 0, 8, 8 );// 1024 binning
   board->SetFrequency( 2.0, true ); // Running at target 2GHz sample rate.
+  UpdateRate();
   // DO NOT ENABLE TRANSPARENT MODE!!!
   // board->SetTranspMode( 1 );
   // board->SetDominoMode( 0 );// Singe shot mode
@@ -171,19 +248,236 @@ DRSContainer::DRSContainer()
 /**
  * @brief Waiting for the DRS4 to be ready for data transfer.
  *
- * This function will suspend the thread indefinitely until the DRS4 is ready
- * for data transfer operation. After the suspension, the data will always be
- * flushed to the main buffer (as this main program is only ever intended to be
- * done with the DRS4 running in single-shot mode).
+ * This function will suspend the thread until the DRS4 is ready for data
+ * transfer operation. After the suspension, the data will always be flushed to
+ * the main buffer (as this main program is only ever intended to be done with
+ * the DRS4 running in single-shot mode). An optional timeout in units of
+ * microseconds can be given, with 0 meaning to wait indefinitely. Returns false
+ * if the timeout is reached, in which case no data is transferred.
  */
-void
-DRSContainer::WaitReady()
+bool
+DRSContainer::WaitReady( const unsigned timeout )
 {
   CheckAvailable();
+  const auto deadline = std::chrono::steady_clock::now() + std::chrono::microseconds( timeout );
   while( board->IsBusy() ) {
+    if( timeout && std::chrono::steady_clock::now() > deadline ) {
+      return false;
+    }
     hw::sleep_microseconds( 5 );
   }
   board->TransferWaves( 0, 8 ); // Flush all waveforms into buffer.
+  return true;
+}
+
+/**
+ * @brief Collecting multiple events in a single call.
+ *
+ * For each event, the domino wave is started, and the waveforms of the
+ * requested channels are extracted once the collection has been triggered. The
+ * loop runs entirely in C++ with the GIL released, so the trigger rate is not
+ * limited by per-event python (or server) round trips. The return is a numpy
+ * array of shape (n, len(channels), samples), in units of mV.
+ *
+ * The timeout is applied to each event in units of microseconds (0 to wait
+ * indefinitely). If any event was not triggered within the timeout, the
+ * collection is stopped and an exception is raised.
+ */
+pybind11::array_t<float>
+DRSContainer::CollectEvents( const unsigned n, const std::vector<unsigned>& channels, const unsigned timeout )
+{
+  CheckAvailable();
+  for( const unsigned channel : channels ) {
+    if( channel >= nchannels ) {
+      raise_error( fmt::format( "Invalid channel [{0:d}]", channel ) );
+    }
+  }
+  const unsigned           nchan    = channels.size();
+  const unsigned           nsamples = GetSamples();
+  pybind11::array_t<float> ans( std::vector<size_t>{ n, nchan, nsamples } );
+  float*                   out = ans.mutable_data();
+
+  {
+    pybind11::gil_scoped_release release;
+    const std::shared_ptr<float> scratch = make_wavebuffer();
+    for( unsigned i = 0; i < n; ++i ) {
+      board->StartDomino();
+      if( !WaitReady( timeout ) ) {
+        board->SoftTrigger();
+        raise_error( fmt::format( "Event [{0:d}/{1:d}] was not triggered within [{2:d}] microseconds", i, n, timeout ) );
+      }
+      for( unsigned c = 0; c < nchan; ++c ) {
+        if( board->GetWave( 0, channels[c] * 2, scratch.get() ) ) {
+          raise_error( "Error running DRSBoard::GetWave" );
+        }
+        std::memcpy( out + ( size_t( i ) * nchan + c ) * nsamples, scratch.get(), nsamples * sizeof( float ) );
+      }
+    }
+  }
+  return ans;
+}
+
+/**
+ * @brief Starting the continuous acquisition mode.
+ *
+ * In continuous mode, a producer thread handles the full acquisition cycle:
+ * once the board has been triggered, the waveforms are transferred to the host,
+ * and the domino wave is immediately restarted before the waveforms of the
+ * requested channels are decoded (DRSBoard::GetWave only uses the transferred
+ * data), such that the dead time of the acquisition is only the USB transfer
+ * time. Decoded events are pushed into a lock-free ring buffer that can hold
+ * up to capacity events, which is drained by DRSContainer::DrainEvents. If the
+ * ring is full, the event is discarded, and the dropped event counter is
+ * incremented. A copy of the latest event is also kept for monitoring (see
+ * DRSContainer::LatestEvent), regardless of whether the event was discarded.
+ *
+ * While the continuous acquisition is running, all other methods that
+ * interact with the board are unavailable. The number of samples is fixed to
+ * the setting when the continuous acquisition is started.
+ */
+void
+DRSContainer::StartContinuous( const std::vector<unsigned>& channels, const unsigned capacity )
+{
+  CheckAvailable();
+  if( channels.empty() || capacity == 0 ) {
+    raise_error( "Continuous acquisition requires at least one channel and a non-zero capacity" );
+  }
+  for( const unsigned channel : channels ) {
+    if( channel >= nchannels ) {
+      raise_error( fmt::format( "Invalid channel [{0:d}]", channel ) );
+    }
+  }
+  std::unique_lock<std::mutex> lock( consumer_mutex, std::defer_lock );
+  {
+    pybind11::gil_scoped_release release;
+    lock.lock();
+  }
+  {
+    std::lock_guard<std::mutex> latest_lock( latest_mutex );
+    ring_channels = channels;
+    ring_samples  = GetSamples();
+    ring          = std::make_unique<hw::spsc_ring<float>>( capacity, channels.size() * ring_samples );
+    latest_event.assign( ring->record_size(), 0 );
+    latest_seq = 0;
+  }
+  dropped_events   = 0;
+  collected_events = 0;
+  continuous_run   = true;
+  producer         = std::thread( &DRSContainer::producer_loop, this );
+}
+
+/**
+ * @brief Stopping the continuous acquisition. Events remaining in the ring
+ * can still be drained after the acquisition has stopped.
+ */
+void
+DRSContainer::StopContinuous()
+{
+  continuous_run = false;
+  if( producer.joinable() ) {
+    producer.join();
+  }
+}
+
+/**
+ * @brief Main loop of the continuous acquisition producer thread.
+ *
+ * The thread does not interact with python in any way.
+ */
+void
+DRSContainer::producer_loop()
+{
+  const std::shared_ptr<float> scratch = make_wavebuffer();
+  const size_t                 nchan   = ring_channels.size();
+  std::vector<float>           dropped( ring->record_size() ); // Decoding target if the ring is full
+  board->StartDomino();
+  while( continuous_run ) {
+    if( board->IsBusy() ) {
+      hw::sleep_microseconds( 5 );
+      continue;
+    }
+    board->TransferWaves( 0, 8 );
+    board->StartDomino(); // Re-arming before decoding
+
+    float* slot  = ring->write_slot();
+    float* event = slot ? slot : dropped.data();
+    for( size_t c = 0; c < nchan; ++c ) {
+      board->GetWave( 0, ring_channels[c] * 2, scratch.get() );
+      std::memcpy( event + c * ring_samples, scratch.get(), ring_samples * sizeof( float ) );
+    }
+    {
+      std::lock_guard<std::mutex> latest_lock( latest_mutex );
+      std::memcpy( latest_event.data(), event, latest_event.size() * sizeof( float ) );
+      ++latest_seq;
+    }
+    if( slot == nullptr ) {
+      ++dropped_events;
+      continue;
+    }
+    ring->commit_write();
+    ++collected_events;
+  }
+  board->SoftTrigger(); // Stopping the pending domino wave
+}
+
+/**
+ * @brief Extracting up to max_events events from the continuous acquisition
+ * ring.
+ *
+ * If the ring is empty, wait up to timeout (in microseconds, 0 to wait
+ * indefinitely, as for DRSContainer::WaitReady) for at least one event to
+ * arrive, with the GIL released. The wait also ends if the acquisition is
+ * stopped. The return is a numpy array of shape (n, len(channels), samples),
+ * where n may be 0 if no event arrived.
+ */
+pybind11::array_t<float>
+DRSContainer::DrainEvents( const unsigned max_events, const unsigned timeout )
+{
+  if( !ring ) {
+    raise_error( "Continuous acquisition was not started" );
+  }
+  // The lock must only be acquired without holding the GIL to avoid deadlocks
+  // with other threads waiting on the lock.
+  std::unique_lock<std::mutex> lock( consumer_mutex, std::defer_lock );
+  {
+    pybind11::gil_scoped_release release;
+    lock.lock();
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::microseconds( timeout );
+    while( ring->size() == 0 && continuous_run && ( timeout == 0 || std::chrono::steady_clock::now() < deadline ) ) {
+      hw::sleep_microseconds( 50 );
+    }
+  }
+
+  const size_t             n     = std::min( (size_t)max_events, ring->size() );
+  const size_t             nchan = ring_channels.size();
+  pybind11::array_t<float> ans( std::vector<size_t>{ n, nchan, (size_t)ring_samples } );
+  float*                   out = ans.mutable_data();
+  for( size_t i = 0; i < n; ++i ) {
+    std::memcpy( out + i * ring->record_size(), ring->read_slot(), ring->record_size() * sizeof( float ) );
+    ring->commit_read();
+  }
+  return ans;
+}
+
+/**
+ * @brief Copy of the latest event decoded by the continuous acquisition.
+ *
+ * The copy is made by the producer thread, so unlike DRSContainer::DrainEvents
+ * this does not remove any events from the ring, and can be called while
+ * another thread is draining the ring. Returns a tuple of the event sequence
+ * number (0 if no event has been decoded yet, incremented for every decoded
+ * event) and the event as an array of shape (len(channels), samples).
+ */
+pybind11::tuple
+DRSContainer::LatestEvent()
+{
+  std::lock_guard<std::mutex> latest_lock( latest_mutex );
+  if( !ring ) {
+    raise_error( "Continuous acquisition was not started" );
+  }
+  pybind11::array_t<float> ans( std::vector<size_t>{ ring_channels.size(), (size_t)ring_samples } );
+  std::memcpy( ans.mutable_data(), latest_event.data(), latest_event.size() * sizeof( float ) );
+  return pybind11::make_tuple( latest_seq, ans );
 }
 
 /**
@@ -225,41 +519,87 @@ DRSContainer::GetTimeArray( const unsigned channel )
  * @brief Returning the last collected waveform as an array of floats
  *
  * This is a lowest level interface with the DRS4 API, and so no conversion
- * will be returned here, the return vector will always be a fixed length long
+ * will be returned here, the return buffer will always be a fixed length long
  * (2048). Conversion should be handled by the other functions.
  *
+ * The waveform is written directly into a 64-byte aligned buffer that is
+ * persistent for each channel, so that the readout does not require any heap
+ * allocation. The buffer is shared with the numpy arrays returned by
+ * DRSContainer::GetWaveform, so if a previously returned array is still alive
+ * when the next waveform is read, a new buffer will be allocated for the
+ * channel to avoid overwriting the data held by the array.
+ *
  * Notice that this function will wait indefinitely for the board to finish
  * data collection. So the user is responsible for making sure that the
  * appropriate trigger signal is sent.
  */
-std::vector<float>
+const std::shared_ptr<float>&
 DRSContainer::GetWaveFormRaw( const unsigned channel )
 {
-  static const unsigned len = 2048;
-  float                 waveform[len];
+  if( channel >= nchannels ) {
+    raise_error( fmt::format( "Invalid channel [{0:d}]", channel ) );
+  }
+  std::shared_ptr<float>& buffer = wavebuffer[channel];
+  if( !buffer || buffer.use_count() > 1 ) {
+    buffer = make_wavebuffer();
+  }
   WaitReady();
 
   // Notice that channel index 0-1 both correspond to the the physical
   // channel 1 input, and so on.
-  int status = board->GetWave( 0, channel * 2, waveform );
+  int status = board->GetWave( 0, channel * 2, buffer.get() );
   if( status ) {
     raise_error( "Error running DRSBoard::GetWave" );
   }
-  return std::vector<float>( waveform, waveform + len );
+  return buffer;
 }
 
 /**
  * @brief Returning the last collected waveform as an array of floats, casting
  * to a numpy compatible array format.
  *
- * We also truncate the array to the n-sample setting.
+ * The returned array is a view of the persistent waveform buffer truncated to
+ * the n-sample setting, with a capsule holding a reference to the buffer to
+ * keep the memory alive for the life time of the array. No data is copied.
  */
 pybind11::array_t<float>
 DRSContainer::GetWaveform( const unsigned channel )
 {
-  return pybind11::array_t<float>( //
-    GetSamples(),
-    GetWaveFormRaw( channel ).data() );
+  const std::shared_ptr<float>& buffer = GetWaveFormRaw( channel );
+  pybind11::capsule owner( new std::shared_ptr<float>( buffer ), //
+                           []( void* p ) { delete static_cast<std::shared_ptr<float>*>( p ); } );
+  return pybind11::array_t<float>( { GetSamples() }, { sizeof( float ) }, buffer.get(), owner );
+}
+
+/**
+ * @brief Filling the last collected waveform into a caller-provided array.
+ *
+ * The waveform is truncated to the n-sample setting, or the length of the
+ * array if it is shorter. The input array is returned for convenience.
+ */
+pybind11::array_t<float>
+DRSContainer::GetWaveformInto( const unsigned channel, pybind11::array_t<float> out )
+{
+  if( out.ndim() != 1 || out.strides( 0 ) != sizeof( float ) ) {
+    raise_error( "Output array must be a contiguous 1D array" );
+  }
+  const std::shared_ptr<float>& buffer = GetWaveFormRaw( channel );
+  const size_t                  len    = std::min( (size_t)GetSamples(), (size_t)out.shape( 0 ) );
+  std::memcpy( out.mutable_data(), buffer.get(), len * sizeof( float ) );
+  return out;
+}
+
+/**
+ * @brief Allocating a 64-byte aligned buffer for a single waveform.
+ */
+std::shared_ptr<float>
+DRSContainer::make_wavebuffer()
+{
+  void* ptr = std::aligned_alloc( 64, buffer_length * sizeof( float ) );
+  if( ptr == nullptr ) {
+    throw std::bad_alloc();
+  }
+  return std::shared_ptr<float>( static_cast<float*>( ptr ), std::free );
 }
 
 /**
@@ -282,33 +622,137 @@ DRSContainer::WaveformSum( const unsigned channel,
                            const unsigned _pedstart,
                            const unsigned _pedstop )
 {
-  const auto     waveform = GetWaveFormRaw( channel );
-  const unsigned maxlen   = board->GetChannelDepth();
-  double         pedvalue = 0;
+  const float* waveform = GetWaveFormRaw( channel ).get();
+  return window_sum( waveform, board->GetChannelDepth(), _intstart, _intstop, _pedstart, _pedstop, 1.0 / rate );
+}
+
+/**
+ * @brief Collecting n events, and returning the pedestal-subtracted waveform
+ * sums of the listed channels for each event.
+ *
+ * This is the batched version of DRSContainer::WaveformSum: the acquisition
+ * loop is identical to that of DRSContainer::CollectEvents, but only the
+ * (n, len(channels)) array of waveform sums is returned rather than the full
+ * waveforms. The windows are given as a list of (intstart, intstop, pedstart,
+ * pedstop) sample indices, either one per channel, or a single window used for
+ * all channels.
+ */
+pybind11::array_t<double>
+DRSContainer::WaveformSums( const unsigned                              n,
+                            const std::vector<unsigned>&                channels,
+                            const std::vector<std::array<unsigned, 4>>& windows,
+                            const unsigned                              timeout )
+{
+  CheckAvailable();
+  for( const unsigned channel : channels ) {
+    if( channel >= nchannels ) {
+      raise_error( fmt::format( "Invalid channel [{0:d}]", channel ) );
+    }
+  }
+  if( windows.size() != 1 && windows.size() != channels.size() ) {
+    raise_error( "Number of windows must be 1 or match the number of channels" );
+  }
+  const unsigned            nchan     = channels.size();
+  const unsigned            maxlen    = board->GetChannelDepth();
+  const double              timeslice = 1.0 / rate;
+  pybind11::array_t<double> ans( std::vector<size_t>{ n, nchan } );
+  double*                   out = ans.mutable_data();
+
+  {
+    pybind11::gil_scoped_release release;
+    const std::shared_ptr<float> scratch = make_wavebuffer();
+    for( unsigned i = 0; i < n; ++i ) {
+      board->StartDomino();
+      if( !WaitReady( timeout ) ) {
+        board->SoftTrigger();
+        raise_error( fmt::format( "Event [{0:d}/{1:d}] was not triggered within [{2:d}] microseconds", i, n, timeout ) );
+      }
+      for( unsigned c = 0; c < nchan; ++c ) {
+        if( board->GetWave( 0, channels[c] * 2, scratch.get() ) ) {
+          raise_error( "Error running DRSBoard::GetWave" );
+        }
+        const auto& w           = windows.size() == 1 ? windows[0] : windows[c];
+        out[size_t( i ) * nchan + c] = window_sum( scratch.get(), maxlen, w[0], w[1], w[2], w[3], timeslice );
+      }
+    }
+  }
+  return ans;
+}
+
+/**
+ * @brief Summing the waveform over the integration window, with pedestal
+ * subtraction if the pedestal window is not empty. Windows are truncated to
+ * the maximum length of the waveform.
+ *
+ * See DRSContainer::WaveformSum for details.
+ */
+static double
+window_sum( const float*   waveform,
+            const unsigned maxlen,
+            const unsigned _intstart,
+            const unsigned _intstop,
+            const unsigned _pedstart,
+            const unsigned _pedstop,
+            const double   timeslice )
+{
+  double pedvalue = 0;
 
   // Getting the pedestal value if required
   if( _pedstart != _pedstop ) {
-    const unsigned pedstart = std::max( unsigned( 0 ), _pedstart );
     const unsigned pedstop  = std::min( maxlen, _pedstop );
-    for( unsigned i = pedstart; i < pedstop; ++i ) {
-      pedvalue += waveform[i];
+    const unsigned pedstart = std::min( pedstop, _pedstart );
+    if( pedstop > pedstart ) {
+      pedvalue = sample_sum( waveform, pedstart, pedstop ) / (double)( pedstop - pedstart );
     }
-    pedvalue /= (double)( pedstop - pedstart );
   }
 
   // Running the additional parsing.
-  const unsigned intstart  = std::max( unsigned( 0 ), _intstart );
-  const unsigned intstop   = std::min( maxlen, _intstop );
-  double         ans       = 0;
-  const double   timeslice = 1.0 / GetRate();
-  for( unsigned i = intstart; i < intstop; ++i ) {
-    ans += waveform[i];
-  }
+  const unsigned intstop  = std::min( maxlen, _intstop );
+  const unsigned intstart = std::min( intstop, _intstart );
+  double         ans      = sample_sum( waveform, intstart, intstop );
   ans -= pedvalue * ( intstop - intstart );
   ans *= -timeslice; // Negative to correct pulse direction
   return ans;
 }
 
+/**
+ * @brief Summing the samples in the range [begin, end) in double precision.
+ *
+ * Vectorized with AVX2 (when built with GMQ_DRS_AVX2) or aarch64 NEON
+ * intrinsics (samples are converted to double precision before the
+ * accumulation), with a scalar loop for the remainder and as the fallback.
+ */
+static double
+sample_sum( const float* x, const unsigned begin, const unsigned end )
+{
+  unsigned i   = begin;
+  double   ans = 0;
+#if defined( __AVX2__ )
+  __m256d acc0 = _mm256_setzero_pd();
+  __m256d acc1 = _mm256_setzero_pd();
+  for( ; i + 8 <= end; i += 8 ) {
+    acc0 = _mm256_add_pd( acc0, _mm256_cvtps_pd( _mm_loadu_ps( x + i ) ) );
+    acc1 = _mm256_add_pd( acc1, _mm256_cvtps_pd( _mm_loadu_ps( x + i + 4 ) ) );
+  }
+  alignas( 32 ) double lanes[4];
+  _mm256_store_pd( lanes, _mm256_add_pd( acc0, acc1 ) );
+  ans = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+#elif defined( __ARM_NEON ) && defined( __aarch64__ )
+  float64x2_t acc0 = vdupq_n_f64( 0 );
+  float64x2_t acc1 = vdupq_n_f64( 0 );
+  for( ; i + 4 <= end; i += 4 ) {
+    const float32x4_t v = vld1q_f32( x + i );
+    acc0                = vaddq_f64( acc0, vcvt_f64_f32( vget_low_f32( v ) ) );
+    acc1                = vaddq_f64( acc1, vcvt_high_f64_f32( v ) );
+  }
+  ans = vaddvq_f64( vaddq_f64( acc0, acc1 ) );
+#endif
+  for( ; i < end; ++i ) {
+    ans += x[i];
+  }
+  return ans;
+}
+
 /**
  * @brief Setting the trigger
  *
@@ -385,26 +829,43 @@ DRSContainer::SetRate( const double x )
 {
   CheckAvailable();
   board->SetFrequency( x, true );
+  UpdateRate();
 }
 
 /**
- * @brief Getting the true sampling rate
+ * @brief Getting the true sampling rate. Units in GHz
+ *
+ * The value is cached whenever the sampling rate is changed, so this does not
+ * require a query to the board.
  */
 double
-DRSContainer::GetRate()
+DRSContainer::GetRate() const
 {
-  CheckAvailable();
-  double ans;
-  board->ReadFrequency( 0, &ans );
-  return ans;
+  return rate;
+}
+
+/**
+ * @brief Reading the true sampling rate from the board into the cache.
+ */
+void
+DRSContainer::UpdateRate()
+{
+  board->ReadFrequency( 0, &rate );
 }
 
 /**
  * @brief Getting the number of sample to store.
+ *
+ * While the continuous acquisition is running, the board is owned by the
+ * producer thread, so the setting fixed at the start of the acquisition is
+ * returned instead.
  */
 unsigned
 DRSContainer::GetSamples()
 {
+  if( continuous_run ) {
+    return ring_samples;
+  }
   return std::min( (unsigned)board->GetChannelDepth(), samples );
 }
 
@@ -447,6 +908,9 @@ DRSContainer::CheckAvailable() const
   if( !IsAvailable() ) {
     raise_error( "DRS4 board is not available" );
   }
+  if( continuous_run ) {
+    raise_error( "DRS4 board is not available while continuous acquisition is running" );
+  }
 }
 
 /**
@@ -464,6 +928,7 @@ DRSContainer::IsAvailable() const
 bool
 DRSContainer::IsReady()
 {
+  CheckAvailable();
   return !board->IsBusy();
 }
 
@@ -488,6 +953,7 @@ DRSContainer::RunCalib()
   // initialized.
   DummyCallback _d;
   board->SetFrequency( 2.0, true );
+  UpdateRate();
   board->CalibrateTiming( &_d );
   board->SetRefclk( 0 );
   board->CalibrateVolt( &_d );
@@ -522,6 +988,7 @@ DRSContainer::make_lockfile()
 
 DRSContainer::~DRSContainer()
 {
+  StopContinuous();
   printdebug( "Deallocating the DRS controller" );
 }
 
@@ -539,9 +1006,41 @@ PYBIND11_MODULE( drs, m )
     .def( "set_rate", &DRSContainer::SetRate )
 
     // Data extraction function (operation-like)
+    .def( "collect_events",
+          &DRSContainer::CollectEvents,
+          "Collecting n events, with a timeout per event in microseconds (0 to wait indefinitely)",
+          pybind11::arg( "n" ),
+          pybind11::arg( "channels" ),
+          pybind11::arg( "timeout" ) = unsigned( 0 ) )
     .def( "get_time_slice", &DRSContainer::GetTimeArray )
-    .def( "get_waveform", &DRSContainer::GetWaveform )
+    .def( "get_waveform", &DRSContainer::GetWaveform, pybind11::arg( "channel" ) )
+    .def( "get_waveform", &DRSContainer::GetWaveformInto, pybind11::arg( "channel" ), pybind11::arg( "out" ).noconvert() )
     .def( "get_waveformsum", &DRSContainer::WaveformSum )
+    .def( "get_waveformsums",
+          &DRSContainer::WaveformSums,
+          "Waveform sums of n events, with a timeout per event in microseconds (0 to wait indefinitely)",
+          pybind11::arg( "n" ),
+          pybind11::arg( "channels" ),
+          pybind11::arg( "windows" ),
+          pybind11::arg( "timeout" ) = unsigned( 0 ) )
+
+    // Continuous acquisition
+    .def( "start_continuous",
+          &DRSContainer::StartContinuous,
+          pybind11::arg( "channels" ),
+          pybind11::arg( "capacity" ) = unsigned( 1024 ) )
+    .def( "stop_continuous", &DRSContainer::StopContinuous, pybind11::call_guard<pybind11::gil_scoped_release>() )
+    .def( "drain_events",
+          &DRSContainer::DrainEvents,
+          "Extracting events from the continuous acquisition, waiting up to timeout microseconds for the first event "
+          "(0 to wait indefinitely)",
+          pybind11::arg( "max_events" ),
+          pybind11::arg( "timeout" ) = unsigned( 0 ) )
+    .def( "is_continuous", &DRSContainer::IsContinuous )
+    .def( "ring_occupancy", &DRSContainer::RingOccupancy )
+    .def( "dropped_events", &DRSContainer::DroppedEvents )
+    .def( "collected_events", &DRSContainer::CollectedEvents )
+    .def( "latest_event", &DRSContainer::LatestEvent )
 
     // Getting configurations (read-only operations)
     .def( "get_trigger_channel", &DRSContainer::TriggerChannel )
@@ -0,0 +1,170 @@
+/**
+ * @file drs_mock.hpp
+ * @author Yi-Mu Chen
+ * @brief Simulated stand-in for the DRS4 library.
+ *
+ * @details Minimal re-implementation of the DRS, DRSBoard and DRSCallback
+ * classes used by the DRSContainer, such that the DRS interface can be compiled
+ * and benchmarked without the board or the upstream DRS library. Enabled by the
+ * CMake option GMQ_DRS_MOCK.
+ *
+ * The simulated board acts as if it is receiving external triggers from a
+ * free-running pulse generator with a fixed period, so triggers arriving while
+ * the domino wave is not running are lost. The waveform transfer takes a fixed
+ * amount of time. The two intervals (in microseconds) can be adjusted
+ * with the GMQ_DRS_MOCK_TRIGGER_US and GMQ_DRS_MOCK_TRANSFER_US environment
+ * variables. Waveforms are a negative SiPM-like pulse with random amplitude on
+ * top of a noisy pedestal.
+ */
+#ifndef GANTRYMQ_DRS_MOCK_HPP
+#define GANTRYMQ_DRS_MOCK_HPP
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <thread>
+
+class DRSCallback
+{
+public:
+  virtual void Progress( int ) = 0;
+  virtual ~DRSCallback() {}
+};
+
+class DRSBoard
+{
+public:
+  static constexpr int depth = 1024;
+
+  DRSBoard()
+    : _frequency( 2.0 )
+    , _trigger_us( env_or( "GMQ_DRS_MOCK_TRIGGER_US", 1000 ) )
+    , _transfer_us( env_or( "GMQ_DRS_MOCK_TRANSFER_US", 500 ) )
+    , _armed( false )
+    , _amplitude( 200 )
+    , _start( std::chrono::steady_clock::now() )
+    , _rng( 12345 )
+  {}
+
+  int Init() { return 0; }
+  int GetDRSType() { return 4; }
+  int GetBoardSerialNumber() { return 0; }
+  int GetFirmwareVersion() { return 0; }
+  int GetChannelDepth() { return depth; }
+
+  // Settings, only the sampling frequency is stored
+  int
+  SetFrequency( double frequency, bool )
+  {
+    _frequency = frequency;
+    return 0;
+  }
+  int
+  ReadFrequency( unsigned, double* frequency )
+  {
+    *frequency = _frequency;
+    return 0;
+  }
+  int SetInputRange( double ) { return 0; }
+  int EnableTrigger( int, int ) { return 0; }
+  int SetTriggerSource( int ) { return 0; }
+  int SetTriggerLevel( double ) { return 0; }
+  int SetTriggerPolarity( bool ) { return 0; }
+  int SetTriggerDelayNs( int ) { return 0; }
+  int SetRefclk( int ) { return 0; }
+  int CalibrateTiming( DRSCallback* ) { return 0; }
+  int CalibrateVolt( DRSCallback* ) { return 0; }
+
+  // Acquisition emulation
+  int
+  StartDomino()
+  {
+    // Next trigger of the generator
+    const auto period = std::chrono::microseconds( _trigger_us );
+    const auto since  = std::chrono::steady_clock::now() - _start;
+    _trigger_time     = _start + ( since / period + 1 ) * period;
+    _armed            = true;
+    return 0;
+  }
+  int
+  SoftTrigger()
+  {
+    _trigger_time = std::chrono::steady_clock::now();
+    return 0;
+  }
+  int
+  IsBusy()
+  {
+    return _armed && std::chrono::steady_clock::now() < _trigger_time;
+  }
+  int
+  TransferWaves( int, int )
+  {
+    _armed = false;
+    std::this_thread::sleep_for( std::chrono::microseconds( _transfer_us ) );
+    std::normal_distribution<float> amp( 200, 40 );
+    _amplitude = amp( _rng );
+    return 0;
+  }
+  int GetTriggerCell( unsigned ) { return 0; }
+
+  int
+  GetWave( unsigned, unsigned channel, float* waveform )
+  {
+    std::normal_distribution<float> noise( 0, 1 );
+    const float                     t0 = 100 + 10 * channel;
+    for( int i = 0; i < depth; ++i ) {
+      const float t = ( i - t0 ) / _frequency; // in ns
+      waveform[i]   = noise( _rng );
+      if( t > 0 ) {
+        waveform[i] -= _amplitude * ( std::exp( -t / 20 ) - std::exp( -t / 2 ) );
+      }
+    }
+    return 0;
+  }
+  int
+  GetTime( unsigned, unsigned, int, float* time, bool = true, bool = true )
+  {
+    for( int i = 0; i < depth; ++i ) {
+      time[i] = i / _frequency;
+    }
+    return 0;
+  }
+
+private:
+  double                                _frequency;
+  unsigned                              _trigger_us;
+  unsigned                              _transfer_us;
+  bool                                  _armed;
+  float                                 _amplitude;
+  std::chrono::steady_clock::time_point _start;
+  std::chrono::steady_clock::time_point _trigger_time;
+  std::mt19937                          _rng;
+
+  static unsigned
+  env_or( const char* name, const unsigned fallback )
+  {
+    const char* val = std::getenv( name );
+    return val ? std::strtoul( val, nullptr, 10 ) : fallback;
+  }
+};
+
+class DRS
+{
+public:
+  int
+  GetError( char* str, int size )
+  {
+    std::strncpy( str, "", size );
+    return 0;
+  }
+  int GetNumberOfBoards() { return 1; }
+  DRSBoard* GetBoard( int ) { return &_board; }
+
+private:
+  DRSBoard _board;
+};
+
+#endif
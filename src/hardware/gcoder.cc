@@ -29,16 +29,28 @@
 #include "threadsleep.hpp"
 
 // Standard C++ libraries
+#include <atomic>
+#include <chrono>
 #include <cmath>
+#include <condition_variable>
+#include <deque>
 #include <fmt/core.h>
+#include <functional>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
 
 // Stuff required for tty input and output
 #include <sys/file.h>
 #include <termios.h>
 
 // Pybind11
+#include <pybind11/functional.h>
+#include <pybind11/numpy.h>
 #include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
 
 class GCoder : private hw::fd_accessor
 {
@@ -60,7 +72,12 @@ public:
   inline static void  SetMaxY( const float val ) { _max_y = val; }
   inline static void  SetMaxZ( const float val ) { _max_z = val; }
 
-  std::string RunGcode( const std::string& gcode, const unsigned waitack = 1e4, const unsigned attempt = 0 ) const;
+  static constexpr unsigned max_attempt = 10; /** Maximum number of attempts to send a command */
+
+  std::string RunGcode( const std::string& gcode, const unsigned waitack = 1e5, const unsigned attempt = 0 ) const;
+  std::string SubmitBatch( const std::vector<std::string>& gcodes,
+                           const unsigned                  window  = 4,
+                           const unsigned                  waitack = 1e7 ) const;
 
   // Motion command abstraction
   std::string GetSettings() const;
@@ -76,6 +93,21 @@ public:
   bool UpdateCoordinate();
   bool InMotion();
 
+  std::tuple<float, float, float> WaitMotion( const unsigned timeout = 4e9 );
+  std::tuple<float, float, float> MoveToAndWait( float x, float y, float z, const unsigned timeout = 4e9 );
+
+  // Multi-point trajectories
+  typedef std::function<void(unsigned, float, float, float)> arrival_callback;
+  pybind11::array_t<float> RunTrajectory( const pybind11::array_t<float, pybind11::array::c_style | pybind11::array::forcecast>& points,
+                                          const unsigned          dwell_ms = 0,
+                                          const arrival_callback& callback = nullptr,
+                                          const bool              reorder  = true );
+  std::vector<unsigned>    OrderTrajectory( const std::vector<float>& points ) const;
+
+  // Position auto-report stream
+  void     SetAutoReport( const unsigned interval );
+  unsigned ReportCount() const { return _pos_seq.load(); }
+
   // Floating point comparison.
   static bool MatchCoord( float x, float y );
   float       ModifyTargetCoordinate( float orig, const float max );
@@ -83,9 +115,26 @@ public:
   static inline float round_val( float x ) { return std::round( x * 10 ) / 10; }
 
   // Operation variables
-  float opx, opy, opz; /** target position of the printer */
-  float cx, cy, cz;    /** current position of the printer */
-  float vx, vy, vz;    /** Speed of the gantry head. */
+  float              opx, opy, opz; /** target position of the printer */
+  std::atomic<float> cx, cy, cz;    /** current position of the printer */
+  float              vx, vy, vz;    /** Speed of the gantry head. */
+
+private:
+  // Reader thread and the demultiplexed return lines
+  std::thread                         _reader;
+  std::atomic<bool>                   _reader_run;
+  std::atomic<unsigned>               _pos_seq; /** Number of position reports received */
+  mutable std::deque<std::string>     _line_queue;
+  mutable std::mutex                  _line_mutex;
+  mutable std::condition_variable     _line_cv;
+  mutable std::recursive_mutex        _cmd_mutex; /** Ensuring one command exchange at a time */
+  mutable unsigned                    _stale_ack; /** Number of late acknowledgements to discard */
+
+  void start_reader();
+  void stop_reader();
+  void reader_loop();
+  bool next_line( std::string& line, const unsigned timeout ) const;
+  bool send_and_wait( const std::string& gcode, const unsigned wait_ack, std::string& ack_string ) const;
 };
 
 /**
@@ -106,6 +155,10 @@ float GCoder::_max_z = 460;
  */
 static bool
 check_ack( const std::string& cmd, const std::string& msg );
+static std::string
+numbered_line( const unsigned line_number, const std::string& cmd );
+static bool
+parse_position( const std::string& line, float& x, float& y, float& z );
 
 /**
  * @brief Initializing the communications interface.
@@ -126,6 +179,12 @@ check_ack( const std::string& cmd, const std::string& msg );
 GCoder::GCoder( const std::string& dev_path )
   : //
   hw::fd_accessor( "GCoder", dev_path, O_RDWR | O_NOCTTY | O_NONBLOCK | O_ASYNC )
+  , cx( 0 )
+  , cy( 0 )
+  , cz( 0 )
+  , _reader_run( false )
+  , _pos_seq( 0 )
+  , _stale_ack( 0 )
 {
   static const int speed = B115200;
 
@@ -158,17 +217,24 @@ GCoder::GCoder( const std::string& dev_path )
     raise_error( fmt::format( "Error setting termios. Returned code [{0:s}]", strerror( errno ) ) );
   }
 
-  printmsg( "Waking up printer...." );
-  hw::sleep_seconds( 10 );
-  clear_buffer(); // Flushing the buffer is required for first start up ()
-  SendHome( true, true, true );
-  hw::sleep_milliseconds( 5 );
+  // The reader thread must be stopped before the exception propagates.
+  start_reader();
+  try {
+    printmsg( "Waking up printer...." );
+    hw::sleep_seconds( 10 );
+    clear_buffer(); // Flushing the buffer is required for first start up ()
+    SendHome( true, true, true );
+    hw::sleep_milliseconds( 5 );
 
-  // Setting speed to be as fast as possible
-  SetSpeedLimit( 1000, 1000, 1000 );
+    // Setting speed to be as fast as possible
+    SetSpeedLimit( 1000, 1000, 1000 );
 
-  // Setting acceleration to 3x the factory default:
-  RunGcode( "M201 X1000 Y1000 Z300", 1e5 );
+    // Setting acceleration to 3x the factory default:
+    RunGcode( "M201 X1000 Y1000 Z300", 1e5 );
+  } catch( std::exception& err ) {
+    stop_reader();
+    throw;
+  }
 
   return;
 }
@@ -188,56 +254,306 @@ GCoder::GCoder( const std::string& dev_path )
  * Notice that exactly when the acknowledgement string is reported will depend
  * on the gcode command in question, and so later functions of abstracting
  * gcode commands should be responsible for choosing an appropriate timeout
- * duration to reduce multiple function calls.
+ * duration to reduce multiple function calls. As the function returns as soon
+ * as the acknowledgement arrives, the timeout only matters for messages that
+ * were dropped, and should be generous: a timeout shorter than the serial round
+ * trip will cause the late acknowledgement to be mistaken as the
+ * acknowledgement of the following command.
+ *
+ * If the printer still owes the acknowledgement of an earlier command (see
+ * GCoder::WaitMotion), the command is queued behind the earlier command rather
+ * than dropped. In this case the command is not resent on timeout, its
+ * acknowledgement is recorded as outstanding and an exception is raised.
  */
 std::string
 GCoder::RunGcode( const std::string& gcode, const unsigned wait_ack, const unsigned attempt ) const
 {
-  using namespace std::chrono;
+  std::lock_guard<std::recursive_mutex> lock( _cmd_mutex );
 
-  // static variables
-  static const unsigned maxtry = 10;
-
-  if( attempt >= maxtry ) {
+  if( attempt >= max_attempt ) {
     raise_error( fmt::format(
       R"(ACK string for command [{0:s}] was not received after [{1:d}]
       attempts! The message could be dropped or there is something wrong with
       the device!)",
       gcode,
-      maxtry ) );
+      max_attempt ) );
   }
 
-  // Sending output
   printdebug( fmt::format( "[{0:s}] to USBTERM[{1:s}] (attempt {2:d})", gcode, this->_dev_path, attempt ) );
+  const bool  busy = _stale_ack > 0;
+  std::string ack_string;
+  if( send_and_wait( gcode, wait_ack, ack_string ) ) {
+    return ack_string;
+  }
+  if( busy ) {
+    ++_stale_ack;
+    raise_error( fmt::format( "Printer is busy with a previous command, ACK for [{0:s}] was not received", gcode ) );
+  }
+  return RunGcode( gcode, wait_ack, attempt + 1 );
+}
+
+/**
+ * @brief Sending a single command, and waiting for the acknowledgement string
+ * up to wait_ack microseconds, without any retries. Returns whether the
+ * acknowledgement was received, with the return lines of the printer stored in
+ * ack_string.
+ *
+ * As the printer processes commands in order, the first acknowledgements
+ * received are those still owed for earlier commands that have timed out, which
+ * are discarded together with the lines preceding them.
+ */
+bool
+GCoder::send_and_wait( const std::string& gcode, const unsigned wait_ack, std::string& ack_string ) const
+{
+  using namespace std::chrono;
+
+  std::lock_guard<std::recursive_mutex> lock( _cmd_mutex );
+
+  // Sending output
   this->write( gcode + "\n" ); // Adding an end of string character
   tcdrain( this->_fd );
 
-  high_resolution_clock::time_point start = high_resolution_clock::now();
+  // Collecting the return lines until the line containing the acknowledgement
+  // is received. If the collected lines is a settings report, drop the lines
+  // and continue waiting for the true acknowledgement.
+  const steady_clock::time_point deadline = steady_clock::now() + microseconds( wait_ack );
+  std::string                    line;
+  ack_string.clear();
+  while( next_line( line, std::max( duration_cast<microseconds>( deadline - steady_clock::now() ).count(), 0L ) ) ) {
+    ack_string += line + "\n";
+    if( line.rfind( "ok", 0 ) != 0 ) {
+      continue;
+    }
+    if( _stale_ack > 0 ) {
+      printdebug( fmt::format( "Discarding late acknowledgement before [{0:s}]", gcode ) );
+      --_stale_ack;
+    } else if( check_ack( gcode, ack_string ) ) {
+      printdebug( fmt::format( "Request [{0:s}] is done!", gcode ) );
+      return true;
+    }
+    ack_string.clear();
+  }
+  return false;
+}
+
+/**
+ * @brief Sending a sequence of gcode commands with multiple commands in flight.
+ *
+ * RunGcode waits for the acknowledgement of each command before sending the
+ * next, so the command buffer of the printer is never filled, and the gantry
+ * will come to a full stop between consecutive motion segments. Here we keep
+ * up to `window` commands in flight. This should not exceed the BUFSIZE of the
+ * printer firmware (typically 4), otherwise the firmware input buffer may
+ * overflow.
+ *
+ * Each command is sent with a line number and a checksum (`N<line>
+ * <cmd>*<checksum>`), with the line number reset to 0 with M110 at the start
+ * of the batch. The printer processes commands in order, so the
+ * acknowledgements are matched to the commands in flight in sending order. If
+ * the printer requests a line to be resent (`Resend: <line>`), all commands
+ * starting from the requested line will be resent. As each command after the
+ * corrupted line will also be rejected with a resend request of the same line,
+ * these additional requests (and the acknowledgement string that follows each
+ * resend request) are ignored. If no message is received from the printer for
+ * the wait period, all commands that have not been acknowledged will be
+ * resent.
+ *
+ * The return will be all non-acknowledgement lines returned by the printer.
+ */
+std::string
+GCoder::SubmitBatch( const std::vector<std::string>& gcodes, const unsigned window, const unsigned wait_ack ) const
+{
+  using namespace std::chrono;
+
+  if( gcodes.empty() ) {
+    return "";
+  }
+  std::lock_guard<std::recursive_mutex> lock( _cmd_mutex );
+  RunGcode( "M110 N0" );
+  printdebug( fmt::format( "Sending batch of [{0:d}] commands to USBTERM[{1:s}]", gcodes.size(), this->_dev_path ) );
+
+  std::string ret;
+  std::string line;
+  size_t      acked      = 0; // Number of commands acknowledged
+  size_t      sent       = 0; // Number of commands sent
+  size_t      skip_rs    = 0; // Number of duplicate resend requests to ignore
+  bool        skip_ok    = false;
+  unsigned    attempt    = 0;
+  const auto  max_flight = std::max( window, 1u );
+
+  while( acked < gcodes.size() ) {
+    for( ; sent < gcodes.size() && sent < acked + max_flight; ++sent ) {
+      this->write( numbered_line( sent + 1, gcodes[sent] ) );
+    }
 
-  for( high_resolution_clock::time_point now = high_resolution_clock::now();
-       duration_cast<microseconds>( now - start ).count() < wait_ack;
-       now = high_resolution_clock::now() ) {
-    hw::sleep_milliseconds( 1 );
-    const std::string ack_string = this->read_str();
+    if( !next_line( line, wait_ack ) ) {
+      if( ++attempt >= max_attempt ) {
+        raise_error(
+          fmt::format( "Batch stalled at command [{0:s}] after [{1:d}] attempts!", gcodes[acked], max_attempt ) );
+      }
+      printdebug( fmt::format( "No response for command [{0:s}], resending", gcodes[acked] ) );
+      sent    = acked;
+      skip_rs = 0;
+      continue;
+    }
 
-    if( check_ack( gcode, ack_string ) ) {
-      printdebug( fmt::format( "Request [{0:s}] is done!", gcode ) );
-      clear_buffer();
-      return ack_string;
+    if( line.rfind( "Resend:", 0 ) == 0 ) {
+      skip_ok = true;
+      if( skip_rs > 0 ) {
+        --skip_rs;
+        continue;
+      }
+      const size_t idx = std::strtoul( line.c_str() + 7, nullptr, 10 ) - 1;
+      if( idx < acked || idx > sent ) {
+        raise_error( fmt::format( "Printer requested resend of unexpected line [{0:s}]", line ) );
+      }
+      printdebug( fmt::format( "Resending from command [{0:s}]", gcodes[idx] ) );
+      skip_rs = ( sent > idx ) ? sent - idx - 1 : 0;
+      sent    = idx;
+    } else if( line.rfind( "ok", 0 ) == 0 ) {
+      if( skip_ok ) {
+        skip_ok = false;
+      } else if( acked < sent ) {
+        ++acked;
+        attempt = 0;
+      }
+    } else if( line.rfind( "Error:", 0 ) != 0 ) {
+      ret += line + "\n";
     }
   }
-  return RunGcode( gcode, wait_ack, attempt + 1 );
+  printdebug( fmt::format( "Batch of [{0:d}] commands is done!", gcodes.size() ) );
+  return ret;
 }
 
+/**
+ * @brief Discarding everything currently pending at the file descriptor.
+ *
+ * This is only required on start up, where the printer will emit the boot
+ * messages unprompted. Reading stops once the printer has stopped sending
+ * messages for 5 ms.
+ */
 void
 GCoder::clear_buffer() const
 {
-  // Flushing buffer by repeated read actions
-  for( unsigned n = 1; n > 0; n = this->read_str().length() ) {
-    hw::sleep_milliseconds( 5 );
+  std::string line;
+  while( next_line( line, 5000 ) ) {}
+}
+
+/**
+ * @brief Starting the thread that is in charge of reading all return strings
+ * from the printer.
+ *
+ * As the printer can be configured to emit position reports unprompted (M154),
+ * the return stream of the printer can no longer be read only by the function
+ * that sent a command. Instead, a dedicated thread is the sole reader of the
+ * file descriptor, and demultiplexes the return stream:
+ *
+ * - Position reports are parsed and stored as the current coordinates. Reports
+ *   generated by the auto-report are consumed here.
+ * - All other lines (including the M114 reports) are placed into a queue, to
+ *   be consumed by the command sending methods via GCoder::next_line.
+ *
+ * The reader thread does not interact with python in any way, so it can run
+ * regardless of the state of the GIL.
+ */
+void
+GCoder::start_reader()
+{
+  _reader_run = true;
+  _reader     = std::thread( &GCoder::reader_loop, this );
+}
+
+/**
+ * @brief Stopping the reader thread, blocks until the thread exits.
+ */
+void
+GCoder::stop_reader()
+{
+  _reader_run = false;
+  if( _reader.joinable() ) {
+    _reader.join();
+  }
+}
+
+/**
+ * @brief Main loop of the reader thread.
+ *
+ * The M114 report will have the format `X:<x> Y:<y> Z:<z> E:<e> Count X:<x>
+ * Y:<y> Z:<z>`, where the first set of coordinates is the last requested
+ * position, and the coordinates after "Count" is the position derived from the
+ * stepper positions. The auto-report has the format of `X:<x> Y:<y> Z:<z>
+ * E:<e>`, with the stepper-derived position as the coordinates. Only the
+ * stepper-derived positions are stored. The read timeout is used to
+ * periodically check whether the thread should stop. If the serial device
+ * fails (ex: it is disconnected), the thread logs the error and stops, and
+ * subsequent commands will time out waiting for their responses.
+ */
+void
+GCoder::reader_loop()
+{
+  std::string line;
+  float       x, y, z;
+  while( _reader_run ) {
+    try {
+      if( !read_line( line, 1e5 ) ) {
+        continue;
+      }
+    } catch( std::exception& err ) {
+      printwarn( fmt::format( "Stopping the gantry reader thread: {0:s}", err.what() ) );
+      _reader_run = false;
+      break;
+    }
+    const bool is_report = ( line.rfind( "X:", 0 ) == 0 );
+    if( is_report && parse_position( line, x, y, z ) ) {
+      cx = x;
+      cy = y;
+      cz = z;
+      ++_pos_seq;
+    }
+    if( is_report && line.find( "Count" ) == std::string::npos ) {
+      continue; // Auto report, not a response to a command
+    }
+    {
+      std::lock_guard<std::mutex> lock( _line_mutex );
+      _line_queue.push_back( line );
+    }
+    _line_cv.notify_one();
   }
 }
 
+/**
+ * @brief Extracting the next return line of the printer received by the
+ * reader thread, waiting until the timeout (in units of microseconds) for a
+ * line to arrive.
+ *
+ * Returns false if no line is available before the timeout.
+ */
+bool
+GCoder::next_line( std::string& line, const unsigned timeout ) const
+{
+  std::unique_lock<std::mutex> lock( _line_mutex );
+  if( !_line_cv.wait_for( lock, std::chrono::microseconds( timeout ), [this] { return !_line_queue.empty(); } ) ) {
+    return false;
+  }
+  line = std::move( _line_queue.front() );
+  _line_queue.pop_front();
+  return true;
+}
+
+/**
+ * @brief Enabling the position auto-report of the printer (M154), with the
+ * interval given in units of seconds. Set to 0 to disable.
+ *
+ * When enabled, the current coordinates are updated by the reader thread
+ * without any requests being sent to the printer. Notice that this requires
+ * the printer firmware to be compiled with AUTO_REPORT_POSITION.
+ */
+void
+GCoder::SetAutoReport( const unsigned interval )
+{
+  RunGcode( fmt::format( "M154 S{0:d}", interval ) );
+}
+
 /**
  * @brief Private function for checking the acknowledgement string for gcode
  * execution completion.
@@ -272,6 +588,23 @@ check_ack( const std::string& cmd, const std::string& msg )
   return true;
 }
 
+/**
+ * @brief Formatting a command with the line number and checksum used by the
+ * printer to detect corrupted or dropped lines.
+ *
+ * The checksum is the XOR of all characters preceding the `*` character.
+ */
+static std::string
+numbered_line( const unsigned line_number, const std::string& cmd )
+{
+  const std::string line     = fmt::format( "N{0:d} {1:s}", line_number, cmd );
+  uint8_t           checksum = 0;
+  for( const char c : line ) {
+    checksum ^= c;
+  }
+  return fmt::format( "{0:s}*{1:d}\n", line, checksum );
+}
+
 /**
  * @brief Sending the gantry to home.
  *
@@ -440,7 +773,7 @@ GCoder::MoveTo( float x, float y, float z )
   opz = ModifyTargetCoordinate( opz, GCoder::_max_z );
 
   // Running the code
-  RunGcode( fmt::format( "G0 X{0:.1f} Y{1:.1f} Z{2:.1f}", opx, opy, opz ), 1000 );
+  RunGcode( fmt::format( "G0 X{0:.1f} Y{1:.1f} Z{2:.1f}", opx, opy, opz ), 1e5 );
 
   return;
 }
@@ -448,30 +781,39 @@ GCoder::MoveTo( float x, float y, float z )
 /**
  * @brief Extracting the current coordinates using the M114 gcode command
  *
- * Returns whether the string parsing is completed
+ * The position report is parsed by the reader thread before the
+ * acknowledgement of the command is received, so here we only need to check
+ * that a new position report has been received. Returns whether the
+ * coordinates were updated.
  */
 bool
 GCoder::UpdateCoordinate()
 {
-  float a, b, c, temp; // feed position of extruder.
-  float x, y, z;       // Temporary storage of the extract coordinates.
   try {
-    const int check =
-      sscanf( RunGcode( "M114" ).c_str(), "X:%f Y:%f Z:%f E:%f Count X:%f Y:%f Z:%f", &a, &b, &c, &temp, &x, &y, &z );
-    if( check != 7 ) {
-      return false;
-    } // Early exit for bad parse
-    else {
-      cx = x;
-      cy = y;
-      cz = z;
-      return true;
-    }
+    std::lock_guard<std::recursive_mutex> lock( _cmd_mutex );
+    const unsigned                        seq = _pos_seq;
+    RunGcode( "M114" );
+    return _pos_seq != seq;
   } catch( std::exception& e ) { // Return false if command fails
     return false;
   }
 }
 
+/**
+ * @brief Parsing a position report line. Returns whether the parsing was
+ * successful.
+ *
+ * For the M114 report, the stepper-derived coordinates after "Count" is
+ * returned, otherwise the leading coordinates are returned.
+ */
+static bool
+parse_position( const std::string& line, float& x, float& y, float& z )
+{
+  const size_t count = line.find( "Count" );
+  const char*  start = ( count == std::string::npos ) ? line.c_str() : line.c_str() + count + 5;
+  return sscanf( start, " X:%f Y:%f Z:%f", &x, &y, &z ) == 3;
+}
+
 /**
  * @brief Checking whether the gantry has completed the motion to a set of
  * coordinates.
@@ -494,6 +836,204 @@ GCoder::InMotion()
   }
 }
 
+/**
+ * @brief Suspending the thread until all motion commands sent to the gantry
+ * have been completed, returning the final coordinates.
+ *
+ * Rather than repeatedly requesting the coordinates with M114 until the
+ * coordinates matches the target, we issue the M400 command, which the printer
+ * only acknowledges once the motion planner buffer has been fully cleared. A
+ * single M114 request is then used to update the current coordinates. Unlike
+ * typical commands, the M400 command will not be resent if the
+ * acknowledgement is not received within the timeout (in units of
+ * microseconds), and an exception will be raised instead. As the printer will
+ * still acknowledge the M400 command once the motion is completed, the
+ * acknowledgement is recorded as outstanding, to be discarded by the following
+ * command exchange.
+ *
+ * As this function can suspend the thread for long periods of time, the
+ * python binding releases the GIL for the duration of the function call.
+ */
+std::tuple<float, float, float>
+GCoder::WaitMotion( const unsigned timeout )
+{
+  std::lock_guard<std::recursive_mutex> lock( _cmd_mutex );
+  std::string                           ack_string;
+  if( !send_and_wait( "M400", timeout, ack_string ) ) {
+    ++_stale_ack;
+    raise_error( fmt::format( "Motion was not completed within [{0:d}] microseconds", timeout ) );
+  }
+  if( !UpdateCoordinate() ) {
+    raise_error( "Failed to obtain coordinates after motion completed" );
+  }
+  return std::make_tuple( cx.load(), cy.load(), cz.load() );
+}
+
+/**
+ * @brief Sending the linear motion command, and suspending the thread until
+ * the motion has been completed. Returns the final coordinates.
+ */
+std::tuple<float, float, float>
+GCoder::MoveToAndWait( float x, float y, float z, const unsigned timeout )
+{
+  MoveTo( x, y, z );
+  return WaitMotion( timeout );
+}
+
+/**
+ * @brief Running the gantry through a list of points.
+ *
+ * The points are given as a Nx3 array of (x,y,z) coordinates. The points are
+ * clamped to the accessible range once, then reordered to minimize the
+ * travel distance (see GCoder::OrderTrajectory) unless the reorder flag is set
+ * to false. Each point is considered arrived when the gantry is stationary at
+ * the target, where the gantry will remain for the dwell time (in units of
+ * milliseconds) before moving to the next point.
+ *
+ * If no callback is given, the full trajectory is streamed to the printer as a
+ * single batch: each point is sent as a G0 command followed by M400 (wait for
+ * motion to complete), M114 (report arrival position) and G4 (dwell), such
+ * that no host round trip is required between points. If a callback is given,
+ * then the callback is invoked with (index, x, y, z) on the arrival of each
+ * point, after the dwell time, and the gantry will only move to the next point
+ * after the callback returns. Here the index is the row index of the input
+ * array.
+ *
+ * Returns a Nx3 array of the arrival positions, with rows matching the rows of
+ * the input array. The GIL is released for the duration of the trajectory, and
+ * is only acquired for invoking the callback.
+ */
+pybind11::array_t<float>
+GCoder::RunTrajectory( const pybind11::array_t<float, pybind11::array::c_style | pybind11::array::forcecast>& points,
+                       const unsigned                                                                         dwell_ms,
+                       const arrival_callback&                                                                callback,
+                       const bool                                                                             reorder )
+{
+  if( points.ndim() != 2 || points.shape( 1 ) != 3 ) {
+    raise_error( "Trajectory must be given as a Nx3 array of coordinates" );
+  }
+  const unsigned     n = points.shape( 0 );
+  std::vector<float> target( points.data(), points.data() + 3 * n );
+  std::vector<float> arrival( 3 * n, 0 );
+  for( unsigned i = 0; i < n; ++i ) {
+    target[3 * i + 0] = ModifyTargetCoordinate( target[3 * i + 0], GCoder::_max_x );
+    target[3 * i + 1] = ModifyTargetCoordinate( target[3 * i + 1], GCoder::_max_y );
+    target[3 * i + 2] = ModifyTargetCoordinate( target[3 * i + 2], GCoder::_max_z );
+  }
+
+  std::vector<unsigned> order( n );
+  if( reorder ) {
+    order = OrderTrajectory( target );
+  } else {
+    for( unsigned i = 0; i < n; ++i ) { order[i] = i; }
+  }
+
+  if( callback ) {
+    for( const unsigned idx : order ) {
+      const auto [x, y, z] = MoveToAndWait( target[3 * idx], target[3 * idx + 1], target[3 * idx + 2] );
+      arrival[3 * idx + 0] = x;
+      arrival[3 * idx + 1] = y;
+      arrival[3 * idx + 2] = z;
+      if( dwell_ms ) {
+        hw::sleep_milliseconds( dwell_ms );
+      }
+      callback( idx, x, y, z );
+    }
+  } else if( n > 0 ) {
+    std::vector<std::string> gcodes;
+    for( const unsigned idx : order ) {
+      gcodes.push_back( fmt::format( "G0 X{0:.1f} Y{1:.1f} Z{2:.1f}", //
+                                     target[3 * idx],
+                                     target[3 * idx + 1],
+                                     target[3 * idx + 2] ) );
+      gcodes.push_back( "M400" );
+      gcodes.push_back( "M114" );
+      if( dwell_ms ) {
+        gcodes.push_back( fmt::format( "G4 P{0:d}", dwell_ms ) );
+      }
+    }
+    const std::string output = SubmitBatch( gcodes );
+
+    // Arrival positions are the M114 reports in the returned string in
+    // the order in which the points are visited.
+    unsigned    visited = 0;
+    size_t      begin   = 0;
+    float       x, y, z;
+    std::string line;
+    while( begin < output.size() ) {
+      const size_t end = std::min( output.find( '\n', begin ), output.size() );
+      line             = output.substr( begin, end - begin );
+      begin            = end + 1;
+      if( line.find( "Count" ) == std::string::npos || !parse_position( line, x, y, z ) ) {
+        continue;
+      }
+      if( visited >= n ) {
+        break;
+      }
+      arrival[3 * order[visited] + 0] = x;
+      arrival[3 * order[visited] + 1] = y;
+      arrival[3 * order[visited] + 2] = z;
+      ++visited;
+    }
+    if( visited != n ) {
+      raise_error( fmt::format( "Expected [{0:d}] arrival reports in trajectory, received [{1:d}]", n, visited ) );
+    }
+  }
+
+  // Updating the operation position to the last point of the trajectory
+  if( n > 0 ) {
+    opx = target[3 * order.back() + 0];
+    opy = target[3 * order.back() + 1];
+    opz = target[3 * order.back() + 2];
+  }
+
+  pybind11::gil_scoped_acquire acquire;
+  return pybind11::array_t<float>( { n, 3u }, arrival.data() );
+}
+
+/**
+ * @brief Ordering the points of a trajectory to reduce the travel distance.
+ *
+ * Points are given as a flat array of (x,y,z) coordinates. Starting from the
+ * current target position of the gantry, the next point to visit is always the
+ * closest point that has not yet been visited. Ties are broken by the input
+ * ordering, so for regular grid scans this results in a serpentine path. The
+ * return is the list of point indices in the order that they are visited.
+ */
+std::vector<unsigned>
+GCoder::OrderTrajectory( const std::vector<float>& points ) const
+{
+  const unsigned        n = points.size() / 3;
+  std::vector<unsigned> order;
+  std::vector<bool>     visited( n, false );
+  float                 x = opx, y = opy, z = opz;
+  order.reserve( n );
+
+  for( unsigned step = 0; step < n; ++step ) {
+    unsigned best      = n;
+    float    best_dist = 0;
+    for( unsigned i = 0; i < n; ++i ) {
+      if( visited[i] ) {
+        continue;
+      }
+      const float dx   = points[3 * i + 0] - x;
+      const float dy   = points[3 * i + 1] - y;
+      const float dz   = points[3 * i + 2] - z;
+      const float dist = dx * dx + dy * dy + dz * dz;
+      if( best == n || dist < best_dist ) {
+        best      = i;
+        best_dist = dist;
+      }
+    }
+    visited[best] = true;
+    order.push_back( best );
+    x = points[3 * best + 0];
+    y = points[3 * best + 1];
+    z = points[3 * best + 2];
+  }
+  return order;
+}
+
 /**
  * @brief Simple function to check if two coordinate values are identical, within
  * the gantry resolution of 0.1 mm
@@ -559,6 +1099,7 @@ GCoder::~GCoder()
   } catch( std::exception& err ) {
     // Do nothing if something errors out.
   }
+  stop_reader();
   printdebug( "Deallocating the gantry controls" );
 }
 
@@ -568,24 +1109,54 @@ PYBIND11_MODULE( gcoder, m )
     .def( pybind11::init<const std::string&>() )
 
     // Operation-like functions
-    .def( "run_gcode", &GCoder::RunGcode )
+    .def( "run_gcode",
+          &GCoder::RunGcode,
+          pybind11::arg( "gcode" ),
+          pybind11::arg( "wait_ack" ) = unsigned( 1e5 ),
+          pybind11::arg( "attempt" )  = unsigned( 0 ) )
+    .def( "run_gcode_batch",
+          &GCoder::SubmitBatch,
+          pybind11::arg( "gcodes" ),
+          pybind11::arg( "window" )   = unsigned( 4 ),
+          pybind11::arg( "wait_ack" ) = unsigned( 1e7 ) )
     .def( "set_speed_limit", &GCoder::SetSpeedLimit, pybind11::arg( "x" ), pybind11::arg( "y" ), pybind11::arg( "z" ) )
     .def( "move_to", &GCoder::MoveTo, pybind11::arg( "x" ), pybind11::arg( "y" ), pybind11::arg( "z" ) )
     .def( "enable_stepper", &GCoder::EnableStepper, pybind11::arg( "x" ), pybind11::arg( "y" ), pybind11::arg( "z" ) )
     .def( "disable_stepper", &GCoder::DisableStepper, pybind11::arg( "x" ), pybind11::arg( "y" ), pybind11::arg( "z" ) )
     .def( "send_home", &GCoder::SendHome, pybind11::arg( "x" ), pybind11::arg( "y" ), pybind11::arg( "z" ) )
+    .def( "move_to_and_wait",
+          &GCoder::MoveToAndWait,
+          pybind11::arg( "x" ),
+          pybind11::arg( "y" ),
+          pybind11::arg( "z" ),
+          pybind11::arg( "timeout" ) = unsigned( 4e9 ),
+          pybind11::call_guard<pybind11::gil_scoped_release>() )
+    .def( "wait_motion",
+          &GCoder::WaitMotion,
+          pybind11::arg( "timeout" ) = unsigned( 4e9 ),
+          pybind11::call_guard<pybind11::gil_scoped_release>() )
+
+    .def( "run_trajectory",
+          &GCoder::RunTrajectory,
+          pybind11::arg( "points" ),
+          pybind11::arg( "dwell_ms" ) = unsigned( 0 ),
+          pybind11::arg( "callback" ) = nullptr,
+          pybind11::arg( "reorder" )  = true,
+          pybind11::call_guard<pybind11::gil_scoped_release>() )
+    .def( "set_auto_report", &GCoder::SetAutoReport, pybind11::arg( "interval" ) )
 
     // Read-like functions
     .def( "get_settings", &GCoder::GetSettings )
     .def( "in_motion", &GCoder::InMotion )
+    .def( "report_count", &GCoder::ReportCount )
 
     // Read-like data members (Should only be set via operation-functions)
     .def_readonly( "opx", &GCoder::opx )
     .def_readonly( "opy", &GCoder::opy )
     .def_readonly( "opz", &GCoder::opz )
-    .def_readonly( "cx", &GCoder::cx )
-    .def_readonly( "cy", &GCoder::cy )
-    .def_readonly( "cz", &GCoder::cz )
+    .def_property_readonly( "cx", []( const GCoder& g ) { return g.cx.load(); } )
+    .def_property_readonly( "cy", []( const GCoder& g ) { return g.cy.load(); } )
+    .def_property_readonly( "cz", []( const GCoder& g ) { return g.cz.load(); } )
     .def_readonly( "vx", &GCoder::vx )
     .def_readonly( "vy", &GCoder::vy )
     .def_readonly( "vz", &GCoder::vz )
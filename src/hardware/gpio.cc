@@ -1,32 +1,161 @@
 #include "threadsleep.hpp"
 
+#include <atomic>
+#include <cmath>
+#include <cstdint>
 #include <fmt/core.h>
 #include <gpiod.h> // New interface for working with GPIO
 #include <stdexcept>
 #include <stdio.h>
 #include <string>
+#include <thread>
+#include <tuple>
 #include <unistd.h>
+#include <vector>
 
 // Pybind11
 #include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
+
+/**
+ * @brief Measured timing of a pulse train.
+ *
+ * Edge timestamps are taken immediately after the line value change request
+ * returns, and are given in nanoseconds relative to the scheduled time of the
+ * first rising edge. The jitter is the difference between the measured and
+ * scheduled rising edge, histogrammed in bins of jitter_bin nanoseconds, with
+ * the final bin holding all overflow values.
+ */
+struct pulse_report
+{
+  std::vector<int64_t>  rise;
+  std::vector<int64_t>  fall;
+  int64_t               jitter_bin;
+  std::vector<unsigned> jitter_hist;
+  double                jitter_mean;
+  double                jitter_rms;
+  int64_t               jitter_max;
+  bool                  realtime; // Whether real-time scheduling was applied
+};
+
+/**
+ * @brief Shared state between a pulse train running in a worker thread and
+ * the thread requesting the pulse train.
+ */
+struct pulse_progress
+{
+  std::atomic<bool>     cancel{ false };
+  std::atomic<bool>     running{ false };
+  std::atomic<unsigned> completed{ 0 }; // Number of pulses completed
+  std::atomic<unsigned> total{ 0 };
+};
+
+/**
+ * @brief Running pulse trains in a dedicated worker thread.
+ *
+ * Only a single pulse train can be running at any time. The pulse train
+ * function will be called in the worker thread with the progress object, which
+ * should be used to report the number of completed pulses and check for
+ * cancellation requests. The worker thread does not interact with python in any
+ * way, so the pulse train continues regardless of the GIL.
+ */
+class pulse_worker
+{
+public:
+  pulse_worker() {}
+  pulse_worker( const pulse_worker& ) = delete;
+  ~pulse_worker() { cancel(); }
+
+  template<typename Func>
+  void
+  start( const unsigned n, Func&& func )
+  {
+    if( _progress.running ) {
+      throw std::runtime_error( "A pulse train is already running" );
+    }
+    join();
+    _progress.cancel    = false;
+    _progress.completed = 0;
+    _progress.total     = n;
+    _progress.running   = true;
+    _thread             = std::thread( [this, func]() {
+      _report            = func( _progress );
+      _progress.running = false;
+    } );
+  }
+
+  /** @brief Running flag, number of completed pulses and total pulses */
+  std::tuple<bool, unsigned, unsigned>
+  status() const
+  {
+    return std::make_tuple( _progress.running.load(), _progress.completed.load(), _progress.total.load() );
+  }
+  bool running() const { return _progress.running; }
+
+  /** @brief Stopping the pulse train, returns the number of completed pulses */
+  unsigned
+  cancel()
+  {
+    _progress.cancel = true;
+    join();
+    return _progress.completed;
+  }
+
+  /** @brief Timing report of the last completed pulse train */
+  pulse_report
+  report()
+  {
+    if( _progress.running ) {
+      throw std::runtime_error( "Pulse train is still running" );
+    }
+    join();
+    return _report;
+  }
+
+private:
+  std::thread    _thread;
+  pulse_progress _progress;
+  pulse_report   _report;
+
+  void
+  join()
+  {
+    if( _thread.joinable() ) {
+      _thread.join();
+    }
+  }
+};
 
 /** @brief Wrapper for a working with the GPIO pins.
  *
- * @details Wee are using GPIO as simple digital toggles, so all GPIO devices
- * will be defined as output devices. Because now chips/lines number always be
- * created in pairs, each write request will attempt to reopen the devices in
- * question. The example code is taken from repository:
- * https://github.com/starnight/libgpiod-example
+ * @details Wee are using GPIO as simple digital toggles, so by default all GPIO
+ * devices will be defined as output devices. Because now chips/lines number
+ * always be created in pairs, by default each write request will attempt to
+ * reopen the devices in question, so that other processes can access the line
+ * in between requests. Alternatively, the object can hold the chip and line
+ * request for its entire life time (hold mode), which removes the setup and
+ * tear down system calls from every operation. The example code is taken from
+ * repository: https://github.com/starnight/libgpiod-example
  */
 class gpio
 {
+public:
+  enum DIRECTION
+  {
+    OUTPUT,
+    INPUT
+  };
+
 private:
   uint8_t            _pin_idx; // We only need to keep track of the line number
   struct gpiod_chip* _chip_ptr;
   struct gpiod_line* _line_ptr;
 
 public:
-  gpio( const uint8_t pin_idx );
+  gpio( const uint8_t      pin_idx,
+        const std::string& chip      = "gpiochip0",
+        const bool         hold      = false,
+        const DIRECTION    direction = OUTPUT );
   gpio( const gpio& )  = delete;
   gpio( const gpio&& ) = delete;
   ~gpio();
@@ -35,53 +164,201 @@ public:
   void write( const bool );
   bool read();
   // Fast pulsing result
-  void pulse( const unsigned n, const unsigned wait );
+  void         pulse( const unsigned n, const unsigned wait );
+  pulse_report pulse_train( const unsigned n,
+                            const uint64_t period,
+                            const uint64_t high     = 0,
+                            const int      priority = 0,
+                            const int      cpu      = -1,
+                            const unsigned spin     = 50000 );
+
+  // Background pulsing
+  void                                 pulse_async( const unsigned n, const unsigned wait );
+  std::tuple<bool, unsigned, unsigned> pulse_status() const { return _worker.status(); }
+  unsigned                             pulse_cancel() { return _worker.cancel(); }
+  pulse_report                         last_pulse_report() { return _worker.report(); }
+
+  // Line configurations
+  void      set_direction( const DIRECTION );
+  DIRECTION direction() const { return _direction; }
+  bool      held() const { return _hold; }
 
 private:
+  const std::string _chip_name;
   const std::string _consume_str;
+  const bool        _hold;
+  DIRECTION         _direction;
+  int               _value; // Last value written to the line
+  pulse_worker      _worker;
 
   void prepare();
   void release();
+  void acquire();
+  void done();
+};
+
+/**
+ * @brief Wrapper for working with multiple GPIO lines on the same chip at once.
+ *
+ * @details All lines are requested with a single bulk request that is held
+ * for the life time of the object, and line values are all read or written
+ * with a single request, such that lines that need to change together do so
+ * without skew between them, and without the system calls of handling each
+ * line individually. As the bulk interface always sets all lines, the last
+ * written values are cached for partial updates.
+ */
+class gpio_bank
+{
+public:
+  gpio_bank( const std::vector<unsigned>& pins,
+             const std::string&           chip      = "gpiochip0",
+             const gpio::DIRECTION        direction = gpio::OUTPUT );
+  gpio_bank( const gpio_bank& ) = delete;
+  ~gpio_bank();
+
+  void             write( const std::vector<int>& values );
+  void             write_line( const unsigned index, const bool x );
+  std::vector<int> read();
+  pulse_report     pulse_train( const std::vector<unsigned>& lines,
+                                const unsigned               n,
+                                const uint64_t               period,
+                                const uint64_t               high     = 0,
+                                const int                    priority = 0,
+                                const int                    cpu      = -1,
+                                const unsigned               spin     = 50000 );
+
+  // Background pulsing
+  void                                 pulse_async( const std::vector<unsigned>& lines, const unsigned n, const unsigned wait );
+  std::tuple<bool, unsigned, unsigned> pulse_status() const { return _worker.status(); }
+  unsigned                             pulse_cancel() { return _worker.cancel(); }
+  pulse_report                         last_pulse_report() { return _worker.report(); }
+
+  const std::vector<unsigned>& pins() const { return _pins; }
+
+private:
+  struct gpiod_chip*     _chip_ptr;
+  struct gpiod_line_bulk _bulk;
+  std::vector<unsigned>  _pins;
+  std::vector<int>       _values; // Last values written to the lines
+  gpio::DIRECTION        _direction;
+  pulse_worker           _worker;
+
+  void set_values( const std::vector<int>& values );
+  void check_idle() const;
+  std::pair<std::vector<int>, std::vector<int>> pulse_values( const std::vector<unsigned>& lines ) const;
 };
 
+template<typename HighFunc, typename LowFunc>
+static pulse_report timed_pulses( const unsigned n,
+                                  const int64_t  period,
+                                  const int64_t  high,
+                                  const int      priority,
+                                  const int      cpu,
+                                  const unsigned spin,
+                                  HighFunc       set_high,
+                                  LowFunc        set_low,
+                                  pulse_progress* progress = nullptr );
+
 /**
  * @brief Logging the line number of interest
+ *
+ * If the line is to be held, the chip and line request is opened immediately,
+ * and will be released when the object is destroyed.
  */
-gpio::gpio( const uint8_t pin_idx )
+gpio::gpio( const uint8_t pin_idx, const std::string& chip, const bool hold, const DIRECTION direction )
   : _pin_idx( pin_idx )
   , _chip_ptr( nullptr )
   , _line_ptr( nullptr )
+  , _chip_name( chip )
   , _consume_str( fmt::format( "cons_gpio_{0:d}", _pin_idx ) )
+  , _hold( hold )
+  , _direction( direction )
+  , _value( 0 )
 {
+  if( _hold ) {
+    prepare();
+  }
 }
 
 gpio::~gpio()
 {
+  _worker.cancel();
   release();
 }
 
 /**
- *  @brief preparing the various devices for writing
+ *  @brief preparing the various devices for writing. Raises an exception if
+ *  the any of the devices cannot be opened.
+ *
+ *  When requesting an output line, the last written value is used as the
+ *  default value, so that re-requesting the line does not glitch the output.
  */
 void
 gpio::prepare()
 {
-  _chip_ptr = gpiod_chip_open_by_name( "gpiochip0" );
+  _chip_ptr = gpiod_chip_open_by_name( _chip_name.c_str() );
   if( !_chip_ptr ) {
-    perror( "Open chip failed\n" );
     release();
+    throw std::runtime_error( fmt::format( "Failed to open GPIO chip [{0:s}]", _chip_name ) );
   }
 
   _line_ptr = gpiod_chip_get_line( _chip_ptr, _pin_idx );
   if( !_line_ptr ) {
-    perror( "Get line failed\n" );
     release();
+    throw std::runtime_error( fmt::format( "Failed to get GPIO line [{0:d}]", _pin_idx ) );
   }
 
-  const int ret = gpiod_line_request_output( _line_ptr, _consume_str.c_str(), 0 );
+  const int ret = ( _direction == OUTPUT ) //
+                    ? gpiod_line_request_output( _line_ptr, _consume_str.c_str(), _value )
+                    : gpiod_line_request_input( _line_ptr, _consume_str.c_str() );
   if( ret < 0 ) {
-    perror( "Request line as output failed\n" );
+    _line_ptr = nullptr; // Line was not requested, do not release
+    release();
+    throw std::runtime_error( fmt::format( "Failed to request GPIO line [{0:d}]", _pin_idx ) );
+  }
+}
+
+/**
+ * @brief Getting the line ready for an operation, only opens the devices if
+ * the line is not held.
+ */
+void
+gpio::acquire()
+{
+  if( _worker.running() ) {
+    throw std::runtime_error( "Cannot access GPIO line while a pulse train is running" );
+  }
+  if( !_hold ) {
+    prepare();
+  }
+}
+
+/**
+ * @brief Finishing an operation, only closes the devices if the line is not
+ * held.
+ */
+void
+gpio::done()
+{
+  if( !_hold ) {
+    release();
+  }
+}
+
+/**
+ * @brief Changing the line direction. For held lines, the line will be
+ * re-requested with the new direction immediately.
+ */
+void
+gpio::set_direction( const DIRECTION direction )
+{
+  if( _worker.running() ) {
+    throw std::runtime_error( "Cannot change GPIO line while a pulse train is running" );
+  }
+  _direction = direction;
+  if( _hold ) {
     release();
+    prepare();
   }
 }
 
@@ -102,38 +379,35 @@ gpio::release()
 }
 
 /**
- * @brief Slow write operation to toggle the pin value. Run all typically write
+ * @brief Write operation to toggle the pin value. Run all typically write
  * checks. Raises exception if checks fail.
  */
 void
 gpio::write( const bool x )
 {
-  prepare();
-  if( !_line_ptr ) {
-    release();
-    throw std::runtime_error( "Failed to setup file descriptors" );
+  if( _direction != OUTPUT ) {
+    throw std::runtime_error( "Cannot write to GPIO line configured as input" );
   }
+  acquire();
   const int ret = gpiod_line_set_value( _line_ptr, x );
-  release();
+  done();
   if( ret < 0 ) {
     throw std::runtime_error( "Failed to write to file descriptor" );
   }
+  _value = x;
   return;
 }
 
 /**
- * @Slow read operation to check the logical value of GPIO.
+ * @brief Read operation to check the logical value of GPIO. For output lines,
+ * this is the value currently being driven.
  */
 bool
 gpio::read()
 {
-  prepare();
-  if( !_line_ptr ) {
-    release();
-    throw std::runtime_error( "Failed to setup file descriptors" );
-  }
+  acquire();
   const int ret = gpiod_line_get_value( _line_ptr );
-  release();
+  done();
   if( ret < 0 ) {
     throw std::runtime_error( "Failed to read from file descriptor" );
   }
@@ -144,33 +418,411 @@ gpio::read()
  * @brief Generating N pulses with some time in between pulses. Only 1 validity
  * check will performed at the start of the function call.
  *
- * All pulses will have a high-time of 5 nanoseconds, and a w microsecond of
- * down time. The fastest pulse rate is about 100 microseconds.
+ * The rising edges of the pulses are spaced by w microseconds, with the line
+ * being set low immediately after it is set high (the high-time is determined
+ * by the speed of the GPIO interface). See gpio::pulse_train for details of
+ * the timing.
  */
 void
 gpio::pulse( const unsigned n, const unsigned wait )
 {
-  prepare();
-  if( !_line_ptr ) {
-    release();
-    throw std::runtime_error( "Failed to setup file descriptors" );
-    return;
+  pulse_train( n, uint64_t( wait ) * 1000 );
+}
+
+/**
+ * @brief Generating N pulses with precise timing, returning the measured
+ * timing of the pulse edges.
+ *
+ * The pulse rising edges are scheduled with a period in units of nanoseconds,
+ * with the falling edges scheduled high nanoseconds after the rising edges.
+ * Edges are scheduled against the absolute monotonic clock, so timing errors do
+ * not accumulate over the pulse train. To avoid scheduler wake up latency, the
+ * thread only sleeps until spin nanoseconds before each edge, and busy-waits
+ * the remaining time (see hw::sleep_until_ns). If a non-zero priority is given,
+ * the thread runs with the SCHED_FIFO policy at the given priority for the
+ * duration of the pulse train, and if a non-negative cpu is given, the thread
+ * is pinned to that CPU. Real-time scheduling typically requires the
+ * CAP_SYS_NICE capability, the pulse train will still be generated without it.
+ */
+pulse_report
+gpio::pulse_train( const unsigned n,
+                   const uint64_t period,
+                   const uint64_t high,
+                   const int      priority,
+                   const int      cpu,
+                   const unsigned spin )
+{
+  if( _direction != OUTPUT ) {
+    throw std::runtime_error( "Cannot pulse GPIO line configured as input" );
+  }
+  acquire();
+  const pulse_report report = timed_pulses(
+    n,
+    period,
+    high,
+    priority,
+    cpu,
+    spin,
+    [this]() { gpiod_line_set_value( _line_ptr, 1 ); },
+    [this]() { gpiod_line_set_value( _line_ptr, 0 ); } );
+  _value = 0;
+  done();
+  return report;
+}
+
+/**
+ * @brief Generating N pulses in a background thread, with the rising edges
+ * spaced by w microseconds (see gpio::pulse).
+ *
+ * The function returns immediately, and the progress of the pulse train can be
+ * monitored with gpio::pulse_status, or stopped with gpio::pulse_cancel. The
+ * line cannot be accessed by any other method while the pulse train is
+ * running.
+ */
+void
+gpio::pulse_async( const unsigned n, const unsigned wait )
+{
+  if( _direction != OUTPUT ) {
+    throw std::runtime_error( "Cannot pulse GPIO line configured as input" );
   }
-  for( unsigned i = 0; i < n; ++i ) {
-    gpiod_line_set_value( _line_ptr, 1 );
-    hw::sleep_nanoseconds( 5 );
-    gpiod_line_set_value( _line_ptr, 0 );
-    hw::sleep_microseconds( wait );
+  acquire(); // Opening the line in the calling thread to report errors
+  _worker.start( n, [this, n, wait]( pulse_progress& progress ) {
+    const pulse_report report = timed_pulses(
+      n,
+      int64_t( wait ) * 1000,
+      0,
+      0,
+      -1,
+      50000,
+      [this]() { gpiod_line_set_value( _line_ptr, 1 ); },
+      [this]() { gpiod_line_set_value( _line_ptr, 0 ); },
+      &progress );
+    _value = 0;
+    done();
+    return report;
+  } );
+}
+
+/**
+ * @brief Timing loop used for all pulse trains, with the set_high and set_low
+ * functions used to change the line values. See gpio::pulse_train for details.
+ */
+template<typename HighFunc, typename LowFunc>
+static pulse_report
+timed_pulses( const unsigned n,
+              const int64_t  period,
+              const int64_t  high,
+              const int      priority,
+              const int      cpu,
+              const unsigned spin,
+              HighFunc       set_high,
+              LowFunc        set_low,
+              pulse_progress* progress )
+{
+  pulse_report report;
+  report.rise.resize( n );
+  report.fall.resize( n );
+  report.jitter_bin = 1000;
+  report.jitter_hist.assign( 100, 0 );
+
+  {
+    hw::realtime_scope rt( priority, cpu );
+    report.realtime = rt.sched_applied();
+
+    const int64_t start = hw::monotonic_ns() + 100000; // Lead time for the first edge
+    for( unsigned i = 0; i < n; ++i ) {
+      if( progress && progress->cancel ) {
+        report.rise.resize( i );
+        report.fall.resize( i );
+        break;
+      }
+      const int64_t rise = start + int64_t( i ) * period;
+      hw::sleep_until_ns( rise, spin );
+      set_high();
+      report.rise[i] = hw::monotonic_ns() - start;
+      if( high ) {
+        hw::sleep_until_ns( rise + high, spin );
+      }
+      set_low();
+      report.fall[i] = hw::monotonic_ns() - start;
+      if( progress ) {
+        progress->completed++;
+      }
+    }
   }
-  release();
+
+  // Computing the jitter statistics
+  const unsigned ndone = report.rise.size();
+  double         sum = 0, sum2 = 0;
+  report.jitter_max = 0;
+  for( unsigned i = 0; i < ndone; ++i ) {
+    const int64_t jitter = report.rise[i] - int64_t( i ) * period;
+    const size_t  bin    = std::min( size_t( jitter / report.jitter_bin ), report.jitter_hist.size() - 1 );
+    report.jitter_hist[bin]++;
+    report.jitter_max = std::max( report.jitter_max, jitter );
+    sum  += jitter;
+    sum2 += double( jitter ) * jitter;
+  }
+  report.jitter_mean = ndone ? sum / ndone : 0;
+  report.jitter_rms  = ndone ? std::sqrt( sum2 / ndone ) : 0;
+  return report;
+}
+
+/**
+ * @brief Opening the chip and requesting all lines of the bank in a single
+ * bulk request, which is held for the life time of the object. Output lines
+ * are initialized to low.
+ */
+gpio_bank::gpio_bank( const std::vector<unsigned>& pins, const std::string& chip, const gpio::DIRECTION direction )
+  : _chip_ptr( nullptr )
+  , _pins( pins )
+  , _values( pins.size(), 0 )
+  , _direction( direction )
+{
+  if( pins.empty() || pins.size() > GPIOD_LINE_BULK_MAX_LINES ) {
+    throw std::runtime_error( fmt::format( "GPIO bank must contain 1-{0:d} lines", GPIOD_LINE_BULK_MAX_LINES ) );
+  }
+  _chip_ptr = gpiod_chip_open_by_name( chip.c_str() );
+  if( !_chip_ptr ) {
+    throw std::runtime_error( fmt::format( "Failed to open GPIO chip [{0:s}]", chip ) );
+  }
+  if( gpiod_chip_get_lines( _chip_ptr, _pins.data(), _pins.size(), &_bulk ) < 0 ) {
+    gpiod_chip_close( _chip_ptr );
+    throw std::runtime_error( "Failed to get GPIO lines" );
+  }
+  const int ret = ( _direction == gpio::OUTPUT ) //
+                    ? gpiod_line_request_bulk_output( &_bulk, "cons_gpio_bank", _values.data() )
+                    : gpiod_line_request_bulk_input( &_bulk, "cons_gpio_bank" );
+  if( ret < 0 ) {
+    gpiod_chip_close( _chip_ptr );
+    throw std::runtime_error( "Failed to request GPIO lines" );
+  }
+}
+
+gpio_bank::~gpio_bank()
+{
+  _worker.cancel();
+  gpiod_line_release_bulk( &_bulk );
+  gpiod_chip_close( _chip_ptr );
+}
+
+/**
+ * @brief Setting the values of all lines in the bank with a single request.
+ */
+void
+gpio_bank::write( const std::vector<int>& values )
+{
+  if( values.size() != _pins.size() ) {
+    throw std::runtime_error( "Number of values must match the number of lines" );
+  }
+  set_values( values );
+}
+
+/**
+ * @brief Setting the value of a single line in the bank (by the index in the
+ * bank), other lines are kept at their current values.
+ */
+void
+gpio_bank::write_line( const unsigned index, const bool x )
+{
+  std::vector<int> values = _values;
+  values.at( index )      = x;
+  set_values( values );
+}
+
+/**
+ * @brief Reading the values of all lines in the bank with a single request.
+ */
+std::vector<int>
+gpio_bank::read()
+{
+  check_idle();
+  std::vector<int> values( _pins.size() );
+  if( gpiod_line_get_value_bulk( &_bulk, values.data() ) < 0 ) {
+    throw std::runtime_error( "Failed to read from file descriptor" );
+  }
+  return values;
+}
+
+/**
+ * @brief Pulsing a subset of the lines in the bank (by the index in the bank)
+ * in lockstep.
+ *
+ * As all lines in the bank are changed in a single request, there is no skew
+ * between the edges of the pulsed lines. Lines not pulsed are kept at their
+ * current values. See gpio::pulse_train for details on the timing parameters.
+ */
+pulse_report
+gpio_bank::pulse_train( const std::vector<unsigned>& lines,
+                        const unsigned               n,
+                        const uint64_t               period,
+                        const uint64_t               high,
+                        const int                    priority,
+                        const int                    cpu,
+                        const unsigned               spin )
+{
+  check_idle();
+  const auto         values = pulse_values( lines );
+  const pulse_report report = timed_pulses(
+    n,
+    period,
+    high,
+    priority,
+    cpu,
+    spin,
+    [&]() { gpiod_line_set_value_bulk( &_bulk, values.first.data() ); },
+    [&]() { gpiod_line_set_value_bulk( &_bulk, values.second.data() ); } );
+  _values = values.second;
+  return report;
+}
+
+/**
+ * @brief Pulsing a subset of the lines in the bank in lockstep in a background
+ * thread, with the rising edges spaced by w microseconds.
+ *
+ * See gpio::pulse_async for details.
+ */
+void
+gpio_bank::pulse_async( const std::vector<unsigned>& lines, const unsigned n, const unsigned wait )
+{
+  check_idle();
+  auto values = pulse_values( lines );
+  _values     = values.second;
+  _worker.start( n, [this, n, wait, values]( pulse_progress& progress ) {
+    return timed_pulses(
+      n,
+      int64_t( wait ) * 1000,
+      0,
+      0,
+      -1,
+      50000,
+      [&]() { gpiod_line_set_value_bulk( &_bulk, values.first.data() ); },
+      [&]() { gpiod_line_set_value_bulk( &_bulk, values.second.data() ); },
+      &progress );
+  } );
+}
+
+/**
+ * @brief Line values for the high and low states of pulsing the listed lines,
+ * with all other lines kept at their current values.
+ */
+std::pair<std::vector<int>, std::vector<int>>
+gpio_bank::pulse_values( const std::vector<unsigned>& lines ) const
+{
+  if( _direction != gpio::OUTPUT ) {
+    throw std::runtime_error( "Cannot pulse GPIO lines configured as input" );
+  }
+  std::vector<int> high_values = _values;
+  std::vector<int> low_values  = _values;
+  for( const unsigned index : lines ) {
+    high_values.at( index ) = 1;
+    low_values.at( index )  = 0;
+  }
+  return std::make_pair( high_values, low_values );
+}
+
+/**
+ * @brief Raising an exception if a background pulse train is running.
+ */
+void
+gpio_bank::check_idle() const
+{
+  if( _worker.running() ) {
+    throw std::runtime_error( "Cannot access GPIO lines while a pulse train is running" );
+  }
+}
+
+/**
+ * @brief Setting all line values, caching the values on success.
+ */
+void
+gpio_bank::set_values( const std::vector<int>& values )
+{
+  check_idle();
+  if( _direction != gpio::OUTPUT ) {
+    throw std::runtime_error( "Cannot write to GPIO lines configured as input" );
+  }
+  if( gpiod_line_set_value_bulk( &_bulk, values.data() ) < 0 ) {
+    throw std::runtime_error( "Failed to write to file descriptor" );
+  }
+  _values = values;
 }
 
 PYBIND11_MODULE( gpio, m )
 {
-  pybind11::class_<gpio>( m, "gpio" )
-    .def( pybind11::init<const uint8_t>() )
+  pybind11::class_<pulse_report>( m, "pulse_report" )
+    .def_readonly( "rise", &pulse_report::rise )
+    .def_readonly( "fall", &pulse_report::fall )
+    .def_readonly( "jitter_bin", &pulse_report::jitter_bin )
+    .def_readonly( "jitter_hist", &pulse_report::jitter_hist )
+    .def_readonly( "jitter_mean", &pulse_report::jitter_mean )
+    .def_readonly( "jitter_rms", &pulse_report::jitter_rms )
+    .def_readonly( "jitter_max", &pulse_report::jitter_max )
+    .def_readonly( "realtime", &pulse_report::realtime );
+
+  pybind11::class_<gpio> gpio_class( m, "gpio" );
+  pybind11::enum_<gpio::DIRECTION>( gpio_class, "DIRECTION" )
+    .value( "OUTPUT", gpio::OUTPUT )
+    .value( "INPUT", gpio::INPUT )
+    .export_values();
+
+  gpio_class
+    .def( pybind11::init<const uint8_t, const std::string&, const bool, const gpio::DIRECTION>(),
+          pybind11::arg( "pin" ),
+          pybind11::arg( "chip" )      = "gpiochip0",
+          pybind11::arg( "hold" )      = false,
+          pybind11::arg( "direction" ) = gpio::OUTPUT )
     // Command-like function calls
     .def( "write", &gpio::write )
     .def( "read", &gpio::read )
-    .def( "pulse", &gpio::pulse, pybind11::arg( "n" ), pybind11::arg( "wait" ) );
+    .def( "pulse",
+          &gpio::pulse,
+          pybind11::arg( "n" ),
+          pybind11::arg( "wait" ),
+          pybind11::call_guard<pybind11::gil_scoped_release>() )
+    .def( "pulse_train",
+          &gpio::pulse_train,
+          pybind11::arg( "n" ),
+          pybind11::arg( "period" ),
+          pybind11::arg( "high" )     = uint64_t( 0 ),
+          pybind11::arg( "priority" ) = 0,
+          pybind11::arg( "cpu" )      = -1,
+          pybind11::arg( "spin" )     = unsigned( 50000 ),
+          pybind11::call_guard<pybind11::gil_scoped_release>() )
+    .def( "pulse_async", &gpio::pulse_async, pybind11::arg( "n" ), pybind11::arg( "wait" ) )
+    .def( "pulse_status", &gpio::pulse_status )
+    .def( "pulse_cancel", &gpio::pulse_cancel, pybind11::call_guard<pybind11::gil_scoped_release>() )
+    .def( "last_pulse_report", &gpio::last_pulse_report, pybind11::call_guard<pybind11::gil_scoped_release>() )
+    .def( "set_direction", &gpio::set_direction )
+    // Configuration read
+    .def( "direction", &gpio::direction )
+    .def( "held", &gpio::held );
+
+  pybind11::class_<gpio_bank>( m, "gpio_bank" )
+    .def( pybind11::init<const std::vector<unsigned>&, const std::string&, const gpio::DIRECTION>(),
+          pybind11::arg( "pins" ),
+          pybind11::arg( "chip" )      = "gpiochip0",
+          pybind11::arg( "direction" ) = gpio::OUTPUT )
+    .def( "write", &gpio_bank::write, pybind11::arg( "values" ) )
+    .def( "write_line", &gpio_bank::write_line, pybind11::arg( "index" ), pybind11::arg( "value" ) )
+    .def( "read", &gpio_bank::read )
+    .def( "pulse_train",
+          &gpio_bank::pulse_train,
+          pybind11::arg( "lines" ),
+          pybind11::arg( "n" ),
+          pybind11::arg( "period" ),
+          pybind11::arg( "high" )     = uint64_t( 0 ),
+          pybind11::arg( "priority" ) = 0,
+          pybind11::arg( "cpu" )      = -1,
+          pybind11::arg( "spin" )     = unsigned( 50000 ),
+          pybind11::call_guard<pybind11::gil_scoped_release>() )
+    .def( "pulse_async",
+          &gpio_bank::pulse_async,
+          pybind11::arg( "lines" ),
+          pybind11::arg( "n" ),
+          pybind11::arg( "wait" ) )
+    .def( "pulse_status", &gpio_bank::pulse_status )
+    .def( "pulse_cancel", &gpio_bank::pulse_cancel, pybind11::call_guard<pybind11::gil_scoped_release>() )
+    .def( "last_pulse_report", &gpio_bank::last_pulse_report, pybind11::call_guard<pybind11::gil_scoped_release>() )
+    .def( "pins", &gpio_bank::pins );
 }
@@ -0,0 +1,506 @@
+#include "i2c_ads1115.hpp"
+#include "i2c_mcp4725.hpp"
+#include "threadsleep.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <stdexcept>
+#include <thread>
+
+#include <pybind11/pybind11.h>
+
+/**
+ * @brief Snapshot of the regulator state. Voltages are in units of mV, times in
+ * units of seconds.
+ */
+struct regulator_status
+{
+  bool          running;
+  bool          fault;       // Loop stopped due to repeated readout failures
+  float         target;      // Requested HV value
+  float         setpoint;    // Slew-limited setpoint currently tracked
+  float         measured;    // Latest HV readout
+  float         error;       // Latest setpoint - measured
+  float         error_rms;   // Exponentially weighted RMS of the error
+  float         dac;         // Latest DAC output (in DAC counts)
+  bool          settled;     // Within tolerance of the target for the settle window
+  double        settle_time; // Time from set_target to settling, negative if not settled yet
+  unsigned long iterations;
+  unsigned long errors; // Number of readout failures
+};
+
+/**
+ * @brief Interface to the HV module: a DAC setting the control voltage, and a
+ * readout of the HV.
+ */
+class hv_plant
+{
+public:
+  virtual ~hv_plant() {}
+  virtual void  set_dac( const uint16_t value ) = 0;
+  virtual float get_dac()                       = 0;
+  virtual float read_hv_mv()                    = 0; // Blocks for the readout conversion
+};
+
+/**
+ * @brief HV module driven by an MCP4725 DAC, with the HV read by an ADS1115 ADC
+ * channel through a resistor divider.
+ */
+class i2c_hv_plant : public hv_plant
+{
+public:
+  i2c_hv_plant( i2c_mcp4725& dac, i2c_ads1115& adc, const uint8_t channel, const uint8_t range, const float divider )
+    : _dac( dac )
+    , _adc( adc )
+    , _channel( channel )
+    , _range( range )
+    , _divider( divider )
+  {}
+  void  set_dac( const uint16_t value ) override { _dac.set_int( value ); }
+  float get_dac() override { return _dac.read_int(); }
+  float read_hv_mv() override { return _adc.read_mv( _channel, _range, i2c_ads1115::ADS_RATE_860SPS ) * _divider; }
+
+private:
+  i2c_mcp4725&  _dac;
+  i2c_ads1115&  _adc;
+  const uint8_t _channel;
+  const uint8_t _range;
+  const float   _divider;
+};
+
+/**
+ * @brief Simulated HV module for testing the regulator without the hardware.
+ *
+ * @details The HV output follows gain * DAC + offset (in mV) with a first order
+ * response of time constant tau (in seconds). The readout has Gaussian noise,
+ * and takes the same time as a single ADS1115 conversion at 860SPS.
+ */
+class sim_hv_plant : public hv_plant
+{
+public:
+  sim_hv_plant( const float gain, const float offset, const float tau, const float noise )
+    : _gain( gain )
+    , _offset( offset )
+    , _tau( tau )
+    , _noise( 0, noise )
+    , _dac( 0 )
+    , _hv( offset )
+    , _last_ns( hw::monotonic_ns() )
+    , _rng( 12345 )
+  {}
+  void
+  set_dac( const uint16_t value ) override
+  {
+    update();
+    _dac = value;
+  }
+  float get_dac() override { return _dac; }
+  float
+  read_hv_mv() override
+  {
+    hw::sleep_microseconds( i2c_ads1115::conversion_us( i2c_ads1115::ADS_RATE_860SPS ) );
+    update();
+    return _hv + _noise( _rng );
+  }
+
+private:
+  const float                     _gain;
+  const float                     _offset;
+  const float                     _tau;
+  std::normal_distribution<float> _noise;
+  uint16_t                        _dac;
+  float                           _hv;
+  int64_t                         _last_ns;
+  std::mt19937                    _rng;
+
+  // Exact response to the DAC output held since the last update
+  void
+  update()
+  {
+    const int64_t now = hw::monotonic_ns();
+    const float   dt  = ( now - _last_ns ) * 1e-9;
+    _hv += ( _gain * _dac + _offset - _hv ) * ( 1 - std::exp( -dt / _tau ) );
+    _last_ns = now;
+  }
+};
+
+/**
+ * @brief Closed-loop regulation of the HV value using a PI loop running in a
+ * background thread.
+ *
+ * @details The loop reads the HV, and updates the DAC output with a
+ * proportional term (kp, in DAC counts per mV) and an integral term (ki, in DAC
+ * counts per mV per second). The regulator tracks a setpoint that moves toward
+ * the requested target no faster than the slew limit (in mV per second), so
+ * large changes of the target result in a controlled ramp of the HV. The
+ * integral term is frozen while the output is saturated to avoid wind-up. The
+ * loop starts from the current DAC output and HV value, so starting the
+ * regulator does not cause a jump in the HV.
+ *
+ * The HV is considered settled once the setpoint has reached the target, and
+ * the readout has stayed within the tolerance of the target for the settle
+ * window. If the readout fails repeatedly, the loop is stopped with the DAC
+ * output kept at its last value, and the fault flag is raised.
+ */
+class hv_regulator
+{
+public:
+  hv_regulator( i2c_mcp4725& dac,
+                i2c_ads1115& adc,
+                const uint8_t channel = 0,
+                const uint8_t range   = i2c_ads1115::ADS_RANGE_1V,
+                const float   divider = 101 );
+  static std::unique_ptr<hv_regulator> simulated( const float gain   = 20,
+                                                  const float offset = -500,
+                                                  const float tau    = 0.05,
+                                                  const float noise  = 20 );
+  hv_regulator( const hv_regulator& ) = delete;
+  ~hv_regulator();
+
+  // Loop configuration
+  void set_gains( const float kp, const float ki );
+  void set_slew( const float slew );
+  void set_tolerance( const float tolerance, const float window = 0.1 );
+  void set_period( const unsigned period_us );
+
+  // Loop operation
+  void             set_target( const float target );
+  void             start();
+  void             stop();
+  bool             running() const { return _run; }
+  regulator_status status() const;
+  bool             wait_settled( const float timeout ) const;
+
+private:
+  explicit hv_regulator( std::unique_ptr<hv_plant>&& plant );
+
+  std::unique_ptr<hv_plant> _plant;
+  std::thread               _thread;
+  std::atomic<bool>         _run;
+  mutable std::mutex        _mutex; // Guarding all members below
+
+  // Configurations
+  float    _kp;
+  float    _ki;
+  float    _slew;
+  float    _tolerance;
+  float    _window;
+  unsigned _period_us;
+
+  // Loop state
+  float            _target;
+  float            _integral;
+  int64_t          _target_ns;
+  int64_t          _band_ns; // Time the readout entered the tolerance band, -1 if outside
+  regulator_status _status;
+
+  void loop();
+};
+
+hv_regulator::hv_regulator( i2c_mcp4725&  dac,
+                            i2c_ads1115&  adc,
+                            const uint8_t channel,
+                            const uint8_t range,
+                            const float   divider )
+  : hv_regulator( std::make_unique<i2c_hv_plant>( dac, adc, channel, range, divider ) )
+{}
+
+hv_regulator::hv_regulator( std::unique_ptr<hv_plant>&& plant )
+  : _plant( std::move( plant ) )
+  , _run( false )
+  , _kp( 0.01 )
+  , _ki( 1.0 )
+  , _slew( 10000 )
+  , _tolerance( 100 )
+  , _window( 0.1 )
+  , _period_us( 2000 )
+  , _target( 0 )
+  , _integral( 0 )
+  , _target_ns( 0 )
+  , _band_ns( -1 )
+{
+  _status             = regulator_status();
+  _status.settle_time = -1;
+}
+
+/**
+ * @brief Regulator operating a simulated HV module, see sim_hv_plant for the
+ * model parameters.
+ */
+std::unique_ptr<hv_regulator>
+hv_regulator::simulated( const float gain, const float offset, const float tau, const float noise )
+{
+  return std::unique_ptr<hv_regulator>( new hv_regulator( std::make_unique<sim_hv_plant>( gain, offset, tau, noise ) ) );
+}
+
+hv_regulator::~hv_regulator()
+{
+  stop();
+}
+
+void
+hv_regulator::set_gains( const float kp, const float ki )
+{
+  if( kp < 0 || ki < 0 ) {
+    throw std::runtime_error( "Regulator gains must be non-negative" );
+  }
+  std::lock_guard<std::mutex> lock( _mutex );
+  _kp = kp;
+  _ki = ki;
+}
+
+/**
+ * @brief Maximum rate of change of the setpoint in mV per second, 0 for no
+ * limit.
+ */
+void
+hv_regulator::set_slew( const float slew )
+{
+  if( slew < 0 ) {
+    throw std::runtime_error( "Slew limit must be non-negative" );
+  }
+  std::lock_guard<std::mutex> lock( _mutex );
+  _slew = slew;
+}
+
+void
+hv_regulator::set_tolerance( const float tolerance, const float window )
+{
+  std::lock_guard<std::mutex> lock( _mutex );
+  _tolerance = tolerance;
+  _window    = window;
+}
+
+void
+hv_regulator::set_period( const unsigned period_us )
+{
+  std::lock_guard<std::mutex> lock( _mutex );
+  _period_us = period_us;
+}
+
+/**
+ * @brief Setting the target HV value in mV, starting the loop if it is not
+ * already running.
+ */
+void
+hv_regulator::set_target( const float target )
+{
+  {
+    std::lock_guard<std::mutex> lock( _mutex );
+    _target             = target;
+    _target_ns          = hw::monotonic_ns();
+    _band_ns            = -1;
+    _status.target      = target;
+    _status.settled     = false;
+    _status.settle_time = -1;
+  }
+  start();
+}
+
+/**
+ * @brief Starting the loop from the current DAC output and HV value.
+ */
+void
+hv_regulator::start()
+{
+  if( _run ) {
+    return;
+  }
+  if( _thread.joinable() ) {
+    _thread.join();
+  }
+  const float dac = _plant->get_dac();
+  const float hv  = _plant->read_hv_mv();
+  {
+    std::lock_guard<std::mutex> lock( _mutex );
+    _integral          = dac;
+    _status.setpoint   = hv;
+    _status.measured   = hv;
+    _status.dac        = dac;
+    _status.fault      = false;
+    _status.error_rms  = 0;
+    _status.iterations = 0;
+    _status.errors     = 0;
+  }
+  _run    = true;
+  _thread = std::thread( &hv_regulator::loop, this );
+}
+
+/**
+ * @brief Stopping the loop, the DAC output is kept at its last value.
+ */
+void
+hv_regulator::stop()
+{
+  _run = false;
+  if( _thread.joinable() ) {
+    _thread.join();
+  }
+}
+
+regulator_status
+hv_regulator::status() const
+{
+  std::lock_guard<std::mutex> lock( _mutex );
+  regulator_status            ans = _status;
+  ans.running                       = _run;
+  return ans;
+}
+
+/**
+ * @brief Waiting until the HV has settled at the target, returns false if the
+ * HV has not settled within the timeout (in seconds) or if the loop stopped.
+ */
+bool
+hv_regulator::wait_settled( const float timeout ) const
+{
+  const int64_t deadline = hw::monotonic_ns() + int64_t( timeout * 1e9 );
+  while( hw::monotonic_ns() < deadline ) {
+    const regulator_status s = status();
+    if( s.settled ) {
+      return true;
+    } else if( !s.running ) {
+      return false;
+    }
+    hw::sleep_milliseconds( 5 );
+  }
+  return false;
+}
+
+void
+hv_regulator::loop()
+{
+  static constexpr unsigned max_errors = 10; // Consecutive failures before stopping
+  static constexpr float    rms_weight = 0.01;
+
+  unsigned consecutive = 0;
+  int64_t  last        = hw::monotonic_ns();
+  int64_t  next        = last;
+  while( _run ) {
+    float measured;
+    try {
+      measured = _plant->read_hv_mv();
+    } catch( std::exception& e ) {
+      std::lock_guard<std::mutex> err_lock( _mutex );
+      _status.errors++;
+      if( ++consecutive >= max_errors ) {
+        _status.fault = true;
+        _run          = false;
+      }
+      hw::sleep_milliseconds( 10 );
+      continue;
+    }
+    consecutive = 0;
+
+    std::unique_lock<std::mutex> lock( _mutex );
+    const int64_t                now = hw::monotonic_ns();
+    const float                  dt  = ( now - last ) * 1e-9;
+    last                             = now;
+
+    // Slew-limited setpoint
+    const float step = _target - _status.setpoint;
+    const float max  = _slew * dt;
+    _status.setpoint = ( _slew > 0 && std::fabs( step ) > max ) ? _status.setpoint + std::copysign( max, step ) : _target;
+
+    // PI output with the integral frozen while saturated
+    const float error    = _status.setpoint - measured;
+    const float integral = _integral + _ki * error * dt;
+    const float output   = integral + _kp * error;
+    const float clamped  = std::min( std::max( output, 0.0f ), 4095.0f );
+    if( output == clamped || ( output > clamped ) != ( error > 0 ) ) {
+      _integral = std::min( std::max( integral, 0.0f ), 4095.0f );
+    }
+
+    // Status updates
+    _status.measured  = measured;
+    _status.error     = error;
+    _status.dac       = clamped;
+    _status.error_rms = std::sqrt( ( 1 - rms_weight ) * _status.error_rms * _status.error_rms //
+                                   + rms_weight * error * error );
+    _status.iterations++;
+    if( _status.setpoint == _target && std::fabs( _target - measured ) <= _tolerance ) {
+      _band_ns = _band_ns < 0 ? now : _band_ns;
+    } else {
+      _band_ns = -1;
+    }
+    _status.settled = _band_ns >= 0 && ( now - _band_ns ) * 1e-9 >= _window;
+    if( _status.settled && _status.settle_time < 0 ) {
+      _status.settle_time = ( _band_ns - _target_ns ) * 1e-9;
+    }
+    const int64_t period = int64_t( _period_us ) * 1000;
+    lock.unlock();
+
+    try {
+      _plant->set_dac( std::lround( clamped ) );
+    } catch( std::exception& e ) {
+      std::lock_guard<std::mutex> err_lock( _mutex );
+      _status.errors++;
+    }
+
+    // Fixed loop period, restarting the schedule if the loop is falling behind
+    next += period;
+    if( next < hw::monotonic_ns() ) {
+      next = hw::monotonic_ns();
+    }
+    hw::sleep_until_ns( next, 0 );
+  }
+}
+
+PYBIND11_MODULE( hv_regulator, m )
+{
+  pybind11::class_<regulator_status>( m, "regulator_status" )
+    .def_readonly( "running", &regulator_status::running )
+    .def_readonly( "fault", &regulator_status::fault )
+    .def_readonly( "target", &regulator_status::target )
+    .def_readonly( "setpoint", &regulator_status::setpoint )
+    .def_readonly( "measured", &regulator_status::measured )
+    .def_readonly( "error", &regulator_status::error )
+    .def_readonly( "error_rms", &regulator_status::error_rms )
+    .def_readonly( "dac", &regulator_status::dac )
+    .def_readonly( "settled", &regulator_status::settled )
+    .def_readonly( "settle_time", &regulator_status::settle_time )
+    .def_readonly( "iterations", &regulator_status::iterations )
+    .def_readonly( "errors", &regulator_status::errors );
+
+  // The DAC and ADC instances are passed from the i2c_mcp4725 and i2c_ads1115
+  // modules, and are kept alive for as long as the regulator exists.
+  pybind11::class_<hv_regulator>( m, "hv_regulator" )
+    .def( pybind11::init<i2c_mcp4725&, i2c_ads1115&, const uint8_t, const uint8_t, const float>(),
+          pybind11::arg( "dac" ),
+          pybind11::arg( "adc" ),
+          pybind11::arg( "channel" ) = 0,
+          pybind11::arg( "range" )   = i2c_ads1115::ADS_RANGE_1V,
+          pybind11::arg( "divider" ) = 101.0f,
+          pybind11::keep_alive<1, 2>(),
+          pybind11::keep_alive<1, 3>() )
+    .def_static( "simulated",
+                 &hv_regulator::simulated,
+                 "Regulator operating a simulated HV module",
+                 pybind11::arg( "gain" )   = 20.0f,
+                 pybind11::arg( "offset" ) = -500.0f,
+                 pybind11::arg( "tau" )    = 0.05f,
+                 pybind11::arg( "noise" )  = 20.0f )
+    .def( "set_gains", &hv_regulator::set_gains, pybind11::arg( "kp" ), pybind11::arg( "ki" ) )
+    .def( "set_slew", &hv_regulator::set_slew, pybind11::arg( "slew" ) )
+    .def( "set_tolerance",
+          &hv_regulator::set_tolerance,
+          pybind11::arg( "tolerance" ),
+          pybind11::arg( "window" ) = 0.1f )
+    .def( "set_period", &hv_regulator::set_period, pybind11::arg( "period_us" ) )
+    .def( "set_target",
+          &hv_regulator::set_target,
+          pybind11::arg( "target" ),
+          pybind11::call_guard<pybind11::gil_scoped_release>() )
+    .def( "start", &hv_regulator::start, pybind11::call_guard<pybind11::gil_scoped_release>() )
+    .def( "stop", &hv_regulator::stop, pybind11::call_guard<pybind11::gil_scoped_release>() )
+    .def( "running", &hv_regulator::running )
+    .def( "status", &hv_regulator::status )
+    .def( "wait_settled",
+          &hv_regulator::wait_settled,
+          pybind11::arg( "timeout" ),
+          pybind11::call_guard<pybind11::gil_scoped_release>() );
+}
@@ -1,147 +1,410 @@
-#include "sysfs.hpp"
+#include "i2c_ads1115.hpp"
 #include "threadsleep.hpp"
 
-#include <fcntl.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
 #include <fmt/core.h>
-#include <linux/i2c-dev.h>
-#include <stdint.h>
-#include <sys/ioctl.h>
+#include <limits>
+#include <linux/i2c.h>
 
-#include <pybind11/pybind11.h>
+/**
+ * @brief Registering the device on the shared I2C bus. As no slave address
+ * selection is needed, nothing is sent to the device at construction.
+ */
+i2c_ads1115::i2c_ads1115( const uint8_t bus_id, const uint8_t dev_id )
+  : hw::i2c_device( fmt::format( "ads1115@{0:#x}:{1:#x}", bus_id, dev_id ), bus_id, dev_id )
+  , _config( -1 )
+  , _pointer( -1 )
+  , _sampler_run( false )
+  , _sampler_errors( 0 )
+{}
 
 /**
- * @brief Specialized interactions with the ADS1115 ADC chip over an I2C device.
+ * @brief Returning the readout at a certain channel in units of mVs
+ *
+ * @details For each operation, you will still need to set the read range and
+ * the the sampling rate. The parsing of the write operations to raw bits is
+ * taken from this reference: http://www.bristolwatch.com/rpi/ads1115.html
  *
- * @details Notice that all 4 channels will be forced to have identical
- * settings. While I2C devices must write operations to read data, since writes
- * are effectively instant, we use this chip effectively as a read-only device.
+ * The conversion is performed in single-shot mode, and the conversion complete
+ * flag is polled, such that the readout latency scales with the data rate
+ * (~1.2ms at 860SPS) rather than a fixed wait time.
  */
-class i2c_ads1115 : private hw::fd_accessor
-{
-public:
-  // Default constructor and destructor
-  i2c_ads1115( const uint8_t bus_id, const uint8_t dev_id );
-  i2c_ads1115( const i2c_ads1115& )  = delete;
-  i2c_ads1115( const i2c_ads1115&& ) = delete;
-  ~i2c_ads1115();
-
-  // ADC Range setting code
-  static constexpr uint8_t ADS_RANGE_6V   = 0x0;
-  static constexpr uint8_t ADS_RANGE_4V   = 0x1;
-  static constexpr uint8_t ADS_RANGE_2V   = 0x2;
-  static constexpr uint8_t ADS_RANGE_1V   = 0x3;
-  static constexpr uint8_t ADS_RANGE_p5V  = 0x4;
-  static constexpr uint8_t ADS_RANGE_p25V = 0x5;
-
-  static constexpr uint8_t ADS_RATE_8SPS   = 0x0;
-  static constexpr uint8_t ADS_RATE_16SPS  = 0x1;
-  static constexpr uint8_t ADS_RATE_32SPS  = 0x2;
-  static constexpr uint8_t ADS_RATE_64SPS  = 0x3;
-  static constexpr uint8_t ADS_RATE_128SPS = 0x4;
-  static constexpr uint8_t ADS_RATE_250SPS = 0x5;
-  static constexpr uint8_t ADS_RATE_475SPS = 0x6;
-  static constexpr uint8_t ADS_RATE_860SPS = 0x7;
-
-  float read_mv( const uint8_t channel, const uint8_t range, const uint8_t rate = ADS_RATE_250SPS ) const;
-};
+float
+i2c_ads1115::read_mv( const uint8_t channel, const uint8_t range, const uint8_t rate ) const
+{
+  std::lock_guard<std::mutex> lock( _bus_mutex );
+  // Writing the configuration also starts the conversion.
+  write_config( config_word( channel, range, rate, true ) );
+  wait_conversion( rate );
+  return int16_t( read_register( REG_CONVERSION ) ) * lsb_mv( range );
+}
 
 /**
- * @brief Opening the file descriptor. Notice that because all devices on the
- * same I2C bus uses the same file descriptor, we will *not* lock the file
- * descriptor. But we will need to add an additional I2C device operations to
- * the file descriptor.
+ * @brief Reading multiple samples of multiple channels in a single call.
+ *
+ * @details The device is placed in continuous conversion mode, and the
+ * channels are scanned in the requested order, with n_samples consecutive
+ * conversions read for each channel. If the device is already converting the
+ * first requested channel with the same settings (typically a repeated scan of
+ * the same channel), the configuration write and the settling time are
+ * skipped. Samples are read once every conversion period, padded by 10% to
+ * account for the internal oscillator accuracy.
+ *
+ * The return contains the average readout of each channel in mV, or the raw
+ * samples of each channel in order (nchannels x n_samples) if average is
+ * false.
  */
-i2c_ads1115::i2c_ads1115( const uint8_t bus_id, const uint8_t dev_id )
-  :                                                                        //
-  hw::fd_accessor( fmt::format( "ads1115@{0:#x}:{1:#x}", bus_id, dev_id ), //
-                   fmt::format( "/dev/i2c-{0:d}", bus_id ),                //
-                   hw::fd_accessor::MODE::READ_WRITE,
-                   false )
+std::vector<float>
+i2c_ads1115::scan( const std::vector<uint8_t>& channels,
+                   const uint8_t               range,
+                   const uint8_t               rate,
+                   const unsigned              n_samples,
+                   const bool                  average ) const
 {
-  // connect to ADS1115 as i2c slave
-  if( ioctl( _fd, I2C_SLAVE, dev_id ) == -1 ) {
-    this->close_with_error( fmt::format( "Error: Couldn't access i2c [{0:d}@{:d}]!", _dev_name, dev_id ) );
+  if( n_samples == 0 ) {
+    this->raise_error( "Number of samples must be positive" );
+  }
+  std::vector<float> samples( channels.size() * n_samples );
+  {
+    std::lock_guard<std::mutex> lock( _bus_mutex );
+    const int64_t               period = int64_t( conversion_us( rate ) ) * 1100;
+    for( size_t c = 0; c < channels.size(); ++c ) {
+      const uint16_t config = config_word( channels[c], range, rate, false );
+      if( config != _config ) {
+        write_config( config );
+      }
+      // First conversion is ready one period after the configuration or the
+      // previous read.
+      int64_t next = hw::monotonic_ns() + period;
+      for( unsigned i = 0; i < n_samples; ++i, next += period ) {
+        hw::sleep_until_ns( next, 0 );
+        samples[c * n_samples + i] = int16_t( read_register( REG_CONVERSION ) ) * lsb_mv( range );
+      }
+    }
+  }
+
+  if( !average ) {
+    return samples;
   }
+  std::vector<float> ans( channels.size() );
+  for( size_t c = 0; c < channels.size(); ++c ) {
+    double sum = 0;
+    for( unsigned i = 0; i < n_samples; ++i ) {
+      sum += samples[c * n_samples + i];
+    }
+    ans[c] = sum / n_samples;
+  }
+  return ans;
 }
 
 /**
- * @brief Returning the readout at a certain channel in units of mVs
+ * @brief Starting a background thread that continuously cycles through the
+ * listed channels, with the corresponding readout ranges.
  *
- * @details For each operation, you will still need to set the read range and
- * the the sampling rate. The parsing of the write operations to raw bits is
- * taken from this reference: http://www.bristolwatch.com/rpi/ads1115.html
+ * @details Each readout is a single-shot conversion (see read_mv), so the
+ * readout rate is roughly the conversion rate divided by the number of
+ * channels. The last capacity readouts of each channel are kept in a ring
+ * buffer, and running statistics are kept since the sampler was started (or
+ * since reset_stats). The latest values and summaries are then available
+ * without touching the I2C bus. Other readout methods can still be used while
+ * the sampler is running, they will be interleaved with the sampler readouts.
+ */
+void
+i2c_ads1115::start_sampler( const std::vector<uint8_t>& channels,
+                            const std::vector<uint8_t>& ranges,
+                            const uint8_t               rate,
+                            const unsigned              capacity )
+{
+  if( channels.size() != ranges.size() || channels.empty() ) {
+    this->raise_error( "Sampler requires a non-empty list of channels with matching ranges" );
+  }
+  if( capacity == 0 ) {
+    this->raise_error( "Sampler capacity must be positive" );
+  }
+  stop_sampler();
+
+  std::vector<sampled_channel> sampled( channels.size() );
+  for( size_t i = 0; i < channels.size(); ++i ) {
+    sampled[i].channel   = channels[i] & 0x3;
+    sampled[i].range     = ranges[i];
+    sampled[i].n_total   = 0;
+    sampled[i].latest_ns = 0;
+    sampled[i].ring.resize( capacity );
+  }
+  {
+    std::lock_guard<std::mutex> lock( _stats_mutex );
+    _sampled.swap( sampled );
+  }
+  reset_stats();
+  _sampler_rate   = rate;
+  _sampler_errors = 0;
+  _sampler_run    = true;
+  _sampler        = std::thread( &i2c_ads1115::sampler_loop, this );
+  this->printinfo( fmt::format( "Started sampling {0:d} channels", channels.size() ) );
+}
+
+void
+i2c_ads1115::stop_sampler()
+{
+  _sampler_run = false;
+  if( _sampler.joinable() ) {
+    _sampler.join();
+  }
+}
+
+/**
+ * @brief Clearing the running statistics of all sampled channels. The ring
+ * buffer contents are kept.
+ */
+void
+i2c_ads1115::reset_stats()
+{
+  std::lock_guard<std::mutex> lock( _stats_mutex );
+  for( auto& ch : _sampled ) {
+    ch.count = 0;
+    ch.mean  = 0;
+    ch.m2    = 0;
+    ch.min   = std::numeric_limits<float>::infinity();
+    ch.max   = -std::numeric_limits<float>::infinity();
+  }
+}
+
+/**
+ * @brief Main loop of the sampler thread. Readout failures are counted rather
+ * than terminating the sampler, as the bus may be temporarily unavailable.
+ */
+void
+i2c_ads1115::sampler_loop()
+{
+  while( _sampler_run ) {
+    for( size_t i = 0; i < _sampled.size() && _sampler_run; ++i ) {
+      float value;
+      try {
+        value = read_mv( _sampled[i].channel, _sampled[i].range, _sampler_rate );
+      } catch( std::exception& e ) {
+        _sampler_errors++;
+        hw::sleep_milliseconds( 100 );
+        continue;
+      }
+
+      std::lock_guard<std::mutex> lock( _stats_mutex );
+      sampled_channel&            ch = _sampled[i];
+      ch.ring[ch.n_total % ch.ring.size()] = value;
+      ch.n_total++;
+      ch.latest_ns = hw::monotonic_ns();
+
+      ch.count++;
+      const double delta = value - ch.mean;
+      ch.mean += delta / ch.count;
+      ch.m2 += delta * ( value - ch.mean );
+      ch.min = std::min( ch.min, value );
+      ch.max = std::max( ch.max, value );
+    }
+  }
+}
+
+const i2c_ads1115::sampled_channel&
+i2c_ads1115::find_sampled( const uint8_t channel ) const
+{
+  for( const auto& ch : _sampled ) {
+    if( ch.channel == channel ) {
+      if( ch.n_total == 0 ) {
+        this->raise_error( fmt::format( "No samples collected for channel [{0:d}] yet", channel ) );
+      }
+      return ch;
+    }
+  }
+  this->raise_error( fmt::format( "Channel [{0:d}] is not being sampled", channel ) );
+  return _sampled.front(); // Should not be reached
+}
+
+/**
+ * @brief Latest sampled value of a channel in mV.
  */
 float
-i2c_ads1115::read_mv( const uint8_t channel, const uint8_t range, const uint8_t rate ) const
+i2c_ads1115::latest( const uint8_t channel ) const
+{
+  std::lock_guard<std::mutex> lock( _stats_mutex );
+  const sampled_channel&      ch = find_sampled( channel );
+  return ch.ring[( ch.n_total - 1 ) % ch.ring.size()];
+}
+
+/**
+ * @brief Summary of the sampled values of a channel.
+ *
+ * @details If window is 0, the running statistics since the sampler was started
+ * (or since reset_stats) is returned. Otherwise the statistics is calculated
+ * from the last window samples stored in the ring buffer (limited by the ring
+ * buffer capacity).
+ */
+adc_stats
+i2c_ads1115::summary( const uint8_t channel, const unsigned window ) const
+{
+  std::lock_guard<std::mutex> lock( _stats_mutex );
+  const sampled_channel&      ch = find_sampled( channel );
+  adc_stats                   ans;
+  ans.latest = ch.ring[( ch.n_total - 1 ) % ch.ring.size()];
+  ans.age    = ( hw::monotonic_ns() - ch.latest_ns ) * 1e-9;
+  if( window == 0 ) {
+    ans.n      = ch.count;
+    ans.mean   = ch.mean;
+    ans.stddev = ch.count > 1 ? std::sqrt( ch.m2 / ( ch.count - 1 ) ) : 0;
+    ans.min    = ch.min;
+    ans.max    = ch.max;
+    return ans;
+  }
+
+  ans.n = std::min<unsigned long>( { window, ch.n_total, ch.ring.size() } );
+  double sum = 0, sum2 = 0;
+  ans.min = std::numeric_limits<float>::infinity();
+  ans.max = -std::numeric_limits<float>::infinity();
+  for( unsigned long i = ch.n_total - ans.n; i < ch.n_total; ++i ) {
+    const float value = ch.ring[i % ch.ring.size()];
+    sum += value;
+    sum2 += double( value ) * value;
+    ans.min = std::min( ans.min, value );
+    ans.max = std::max( ans.max, value );
+  }
+  ans.mean   = sum / ans.n;
+  ans.stddev = ans.n > 1 ? std::sqrt( std::max( sum2 - sum * ans.mean, 0.0 ) / ( ans.n - 1 ) ) : 0;
+  return ans;
+}
+
+/**
+ * @brief Sampled values of a channel stored in the ring buffer in mV, from the
+ * oldest to the latest.
+ */
+std::vector<float>
+i2c_ads1115::history( const uint8_t channel ) const
+{
+  std::lock_guard<std::mutex> lock( _stats_mutex );
+  const sampled_channel&      ch = find_sampled( channel );
+  const unsigned long         n  = std::min<unsigned long>( ch.n_total, ch.ring.size() );
+  std::vector<float>          ans( n );
+  for( unsigned long i = 0; i < n; ++i ) {
+    ans[i] = ch.ring[( ch.n_total - n + i ) % ch.ring.size()];
+  }
+  return ans;
+}
+
+/**
+ * @brief Nominal time required for a single conversion at a given rate setting
+ * in units of microseconds.
+ */
+unsigned
+i2c_ads1115::conversion_us( const uint8_t rate )
+{
+  static constexpr unsigned sps[8] = { 8, 16, 32, 64, 128, 250, 475, 860 };
+  return ( 1000000 + sps[rate & 0x7] - 1 ) / sps[rate & 0x7];
+}
+
+/**
+ * @brief Conversion factor from the raw readout to mV based on the range.
+ */
+float
+i2c_ads1115::lsb_mv( const uint8_t range )
+{
+  return range == ADS_RANGE_6V ? 6144.0 / 32678.0 : //
+           range == ADS_RANGE_4V ? 4096.0 / 32678.0
+                                 : //
+           range == ADS_RANGE_2V ? 2048.0 / 32678.0
+                                 : //
+           range == ADS_RANGE_1V ? 1024.0 / 32678.0
+                                 : //
+           range == ADS_RANGE_p5V ? 512.0 / 32678.0
+                                  : //
+           256.0 / 32678.0;
+}
+
+/**
+ * @brief Configuration register value for a single ended readout.
+ */
+uint16_t
+i2c_ads1115::config_word( const uint8_t channel, const uint8_t range, const uint8_t rate, const bool single )
 {
   // byte 1 configuration:
-  // Always  | MUX channel | PGA bits  | MODE (0 for continuous)
-  // 1       | 1  x    x   | x   x   x | 0
-  const uint8_t byte_1 = ( 0x3 << 6 )                 //
-                         | ( ( channel & 0x3 ) << 4 ) //
-                         | ( ( range & 0x7 ) << 1 )   //
-                         | 0x0;
+  // Start   | MUX channel | PGA bits  | MODE (1 for single-shot)
+  // x       | 1  x    x   | x   x   x | x
+  const uint8_t byte_1 = ( ( single ? 0x1 : 0x0 ) << 7 ) //
+                         | ( 0x1 << 6 )                   //
+                         | ( ( channel & 0x3 ) << 4 )     //
+                         | ( ( range & 0x7 ) << 1 )       //
+                         | ( single ? 0x1 : 0x0 );
 
   // Configuration byte 2
   // rate bits | COM BITS (Leave as default)
   // x x x     | 0 0 0 1 1
   const uint8_t byte_2 = ( ( rate & 0x7 ) << 5 ) //
                          | 0b00011;
+  return ( byte_1 << 8 ) | byte_2;
+}
+
+/**
+ * @brief Writing the configuration register. This leaves the pointer register
+ * pointing to the configuration register.
+ */
+void
+i2c_ads1115::write_config( const uint16_t config ) const
+{
+  uint8_t        buf[3] = { REG_CONFIG, uint8_t( config >> 8 ), uint8_t( config & 0xff ) };
+  struct i2c_msg msg    = { _dev_id, 0, 3, buf };
+  _config               = -1; // Unknown state if the write fails
+  _pointer              = -1;
+  transfer( &msg, 1 );
+  _config  = config & 0x7fff; // Start bit is not stored
+  _pointer = REG_CONFIG;
+}
+
+/**
+ * @brief Reading a 16 bit register. If the pointer register does not already
+ * point to the requested register, the pointer write and the read are performed
+ * as a single combined transaction.
+ */
+uint16_t
+i2c_ads1115::read_register( const uint8_t reg ) const
+{
+  uint8_t        ptr    = reg;
+  uint8_t        buf[2] = { 0, 0 };
+  struct i2c_msg msgs[2] = {
+    {_dev_id,        0, 1, &ptr},
+    {_dev_id, I2C_M_RD, 2,  buf}
+  };
+  if( _pointer == reg ) {
+    transfer( msgs + 1, 1 );
+  } else {
+    _pointer = -1;
+    transfer( msgs, 2 );
+    _pointer = reg;
+  }
+  return ( buf[0] << 8 ) | buf[1];
+}
 
-  // Set device to write mode (leading 1), then write configurations
-  this->write( std::vector<uint8_t>( { 1, byte_1, byte_2 } ) );
-  hw::sleep_milliseconds( 50 );
-
-  // Resetting device to read mode
-  this->write( std::vector<uint8_t>( { 0 } ) );
-  hw::sleep_milliseconds( 50 );
-
-  // Reading raw adc values
-  std::vector<uint8_t> val_bytes = this->read_bytes( 2 );
-  int16_t              val_int   = val_bytes[0] << 8 | val_bytes[1];
-
-  // Conversion factor based on requested range.
-  const float conv = range == ADS_RANGE_6V ? 6144.0 / 32678.0 : //
-                       range == ADS_RANGE_4V ? 4096.0 / 32678.0
-                                             : //
-                       range == ADS_RANGE_2V ? 2048.0 / 32678.0
-                                             : //
-                       range == ADS_RANGE_1V ? 1024.0 / 32678.0
-                                             : //
-                       range == ADS_RANGE_p5V ? 512.0 / 32678.0
-                                              : //
-                       256.0 / 32678.0;
-  return float( val_int ) * conv;
-}
-
-i2c_ads1115::~i2c_ads1115() {}
-
-PYBIND11_MODULE( i2c_ads1115, m )
-{
-  pybind11::class_<i2c_ads1115>( m, "i2c_ads1115" )
-    .def( pybind11::init<const uint8_t, const uint8_t>() )
-
-    // Read-only methods.
-    .def( "read_mv",
-          &i2c_ads1115::read_mv,
-          "Returning the readout values in mV",
-          pybind11::arg( "channel" ), //
-          pybind11::arg( "range" ),   //
-          pybind11::arg( "rate" ) = i2c_ads1115::ADS_RATE_250SPS )
-
-    // All static variables are read-only
-    .def_readonly_static( "ADS_RANGE_6V", &i2c_ads1115::ADS_RANGE_6V )
-    .def_readonly_static( "ADS_RANGE_4V", &i2c_ads1115::ADS_RANGE_4V )
-    .def_readonly_static( "ADS_RANGE_2V", &i2c_ads1115::ADS_RANGE_2V )
-    .def_readonly_static( "ADS_RANGE_1V", &i2c_ads1115::ADS_RANGE_1V )
-    .def_readonly_static( "ADS_RANGE_p5V", &i2c_ads1115::ADS_RANGE_p5V )
-    .def_readonly_static( "ADS_RANGE_p25V", &i2c_ads1115::ADS_RANGE_p25V )
-    .def_readonly_static( "ADS_RATE_8SPS", &i2c_ads1115::ADS_RATE_8SPS )
-    .def_readonly_static( "ADS_RATE_16SPS", &i2c_ads1115::ADS_RATE_16SPS )
-    .def_readonly_static( "ADS_RATE_32SPS", &i2c_ads1115::ADS_RATE_32SPS )
-    .def_readonly_static( "ADS_RATE_64SPS", &i2c_ads1115::ADS_RATE_64SPS )
-    .def_readonly_static( "ADS_RATE_128SPS", &i2c_ads1115::ADS_RATE_128SPS )
-    .def_readonly_static( "ADS_RATE_250SPS", &i2c_ads1115::ADS_RATE_250SPS )
-    .def_readonly_static( "ADS_RATE_475SPS", &i2c_ads1115::ADS_RATE_475SPS )
-    .def_readonly_static( "ADS_RATE_860SPS", &i2c_ads1115::ADS_RATE_860SPS );
+/**
+ * @brief Waiting for the single-shot conversion to complete.
+ *
+ * @details The thread sleeps for most of the nominal conversion time, then
+ * polls the OS bit (the most significant bit of the configuration register,
+ * which reads 1 once the device is no longer converting). As the internal
+ * oscillator is only accurate to ~10%, the timeout is generously set to twice
+ * the nominal conversion time.
+ */
+void
+i2c_ads1115::wait_conversion( const uint8_t rate ) const
+{
+  const unsigned conv_us  = conversion_us( rate );
+  const int64_t  deadline = hw::monotonic_ns() + int64_t( 2 * conv_us + 1000 ) * 1000;
+  hw::sleep_microseconds( conv_us * 9 / 10 );
+  while( !( read_register( REG_CONFIG ) & 0x8000 ) ) {
+    if( hw::monotonic_ns() > deadline ) {
+      this->raise_error( fmt::format( "Timeout waiting for conversion on [{0:s}]", _dev_name ) );
+    }
+    hw::sleep_microseconds( std::max( conv_us / 50, 20u ) );
+  }
+}
+
+i2c_ads1115::~i2c_ads1115()
+{
+  stop_sampler();
 }
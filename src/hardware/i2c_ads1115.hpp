@@ -0,0 +1,143 @@
+/**
+ * @file i2c_ads1115.hpp
+ * @author Yi-Mu Chen
+ * @brief Interface to the ADS1115 ADC chip, shared by the python modules that
+ * operate the ADC.
+ */
+#ifndef GANTRYMQ_I2C_ADS1115_HPP
+#define GANTRYMQ_I2C_ADS1115_HPP
+
+#include "i2c_bus.hpp"
+
+#include <atomic>
+#include <mutex>
+#include <stdint.h>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Summary statistics of the readout values of a sampled channel. All
+ * voltage values are in units of mV.
+ */
+struct adc_stats
+{
+  unsigned long n;      // Number of samples used for the summary
+  float         latest; // Latest readout value
+  double        age;    // Time since the latest readout in seconds
+  double        mean;
+  double        stddev;
+  float         min;
+  float         max;
+};
+
+/**
+ * @brief Specialized interactions with the ADS1115 ADC chip over an I2C device.
+ *
+ * @details Notice that all 4 channels will be forced to have identical
+ * settings. While I2C devices must write operations to read data, since writes
+ * are effectively instant, we use this chip effectively as a read-only device.
+ *
+ * The device is accessed through the I2C bus shared with other devices. The
+ * last values written to the configuration and pointer registers are
+ * cached, such that redundant writes can be skipped. Register reads that
+ * require a change of the pointer register are performed as a single combined
+ * I2C transaction.
+ */
+class i2c_ads1115 : private hw::i2c_device
+{
+public:
+  // Default constructor and destructor
+  i2c_ads1115( const uint8_t bus_id, const uint8_t dev_id );
+  i2c_ads1115( const i2c_ads1115& )  = delete;
+  i2c_ads1115( const i2c_ads1115&& ) = delete;
+  ~i2c_ads1115();
+
+  // ADC Range setting code
+  static constexpr uint8_t ADS_RANGE_6V   = 0x0;
+  static constexpr uint8_t ADS_RANGE_4V   = 0x1;
+  static constexpr uint8_t ADS_RANGE_2V   = 0x2;
+  static constexpr uint8_t ADS_RANGE_1V   = 0x3;
+  static constexpr uint8_t ADS_RANGE_p5V  = 0x4;
+  static constexpr uint8_t ADS_RANGE_p25V = 0x5;
+
+  static constexpr uint8_t ADS_RATE_8SPS   = 0x0;
+  static constexpr uint8_t ADS_RATE_16SPS  = 0x1;
+  static constexpr uint8_t ADS_RATE_32SPS  = 0x2;
+  static constexpr uint8_t ADS_RATE_64SPS  = 0x3;
+  static constexpr uint8_t ADS_RATE_128SPS = 0x4;
+  static constexpr uint8_t ADS_RATE_250SPS = 0x5;
+  static constexpr uint8_t ADS_RATE_475SPS = 0x6;
+  static constexpr uint8_t ADS_RATE_860SPS = 0x7;
+
+  float              read_mv( const uint8_t channel, const uint8_t range, const uint8_t rate = ADS_RATE_250SPS ) const;
+  std::vector<float> scan( const std::vector<uint8_t>& channels,
+                           const uint8_t               range,
+                           const uint8_t               rate      = ADS_RATE_250SPS,
+                           const unsigned              n_samples = 1,
+                           const bool                  average   = true ) const;
+
+  // Background sampling
+  void start_sampler( const std::vector<uint8_t>& channels,
+                      const std::vector<uint8_t>& ranges,
+                      const uint8_t               rate     = ADS_RATE_860SPS,
+                      const unsigned              capacity = 1024 );
+  void stop_sampler();
+  bool sampler_running() const { return _sampler_run; }
+  unsigned long sampler_errors() const { return _sampler_errors; }
+  void          reset_stats();
+
+  float              latest( const uint8_t channel ) const;
+  adc_stats          summary( const uint8_t channel, const unsigned window = 0 ) const;
+  std::vector<float> history( const uint8_t channel ) const;
+
+  static unsigned conversion_us( const uint8_t rate );
+  static float    lsb_mv( const uint8_t range );
+
+private:
+  static constexpr uint8_t REG_CONVERSION = 0x0;
+  static constexpr uint8_t REG_CONFIG     = 0x1;
+
+  mutable int32_t _config;  // Last configuration written, -1 for unknown
+  mutable int32_t _pointer; // Current pointer register, -1 for unknown
+
+  // Register access sequences of the python thread and the sampler thread
+  // should not interleave
+  mutable std::mutex _bus_mutex;
+
+  /**
+   * @brief Sampled values of a single channel. The last capacity values are
+   * stored in a ring buffer, and the running statistics are accumulated since
+   * the last reset using Welford's algorithm.
+   */
+  struct sampled_channel
+  {
+    uint8_t            channel;
+    uint8_t            range;
+    std::vector<float> ring;
+    unsigned long      n_total; // Total number of samples written to the ring
+    int64_t            latest_ns;
+    unsigned long      count; // Number of samples in running statistics
+    double             mean;
+    double             m2;
+    float              min;
+    float              max;
+  };
+
+  std::thread                  _sampler;
+  std::atomic<bool>            _sampler_run;
+  std::atomic<unsigned long>   _sampler_errors;
+  uint8_t                      _sampler_rate;
+  std::vector<sampled_channel> _sampled;
+  mutable std::mutex           _stats_mutex;
+
+  void                   sampler_loop();
+  const sampled_channel& find_sampled( const uint8_t channel ) const;
+
+  static uint16_t config_word( const uint8_t channel, const uint8_t range, const uint8_t rate, const bool single );
+
+  void     write_config( const uint16_t config ) const;
+  uint16_t read_register( const uint8_t reg ) const;
+  void     wait_conversion( const uint8_t rate ) const;
+};
+
+#endif
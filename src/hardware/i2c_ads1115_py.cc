@@ -0,0 +1,116 @@
+#include "i2c_ads1115.hpp"
+
+#include <algorithm>
+
+#include <pybind11/numpy.h>
+#include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
+
+/**
+ * @brief Returning the scan results as an array of shape (nchannels,), or of
+ * shape (nchannels, n_samples) if average is false. The GIL is released while
+ * the device is being read.
+ */
+static pybind11::array_t<float>
+scan( const i2c_ads1115&          self,
+      const std::vector<uint8_t>& channels,
+      const uint8_t               range,
+      const uint8_t               rate,
+      const unsigned              n_samples,
+      const bool                  average )
+{
+  std::vector<float> samples;
+  {
+    pybind11::gil_scoped_release release;
+    samples = self.scan( channels, range, rate, n_samples, average );
+  }
+  std::vector<size_t> shape{ channels.size() };
+  if( !average ) {
+    shape.push_back( n_samples );
+  }
+  pybind11::array_t<float> ans( shape );
+  std::copy( samples.begin(), samples.end(), ans.mutable_data() );
+  return ans;
+}
+
+static pybind11::array_t<float>
+history( const i2c_ads1115& self, const uint8_t channel )
+{
+  const std::vector<float> values = self.history( channel );
+  pybind11::array_t<float> ans( std::vector<size_t>{ values.size() } );
+  std::copy( values.begin(), values.end(), ans.mutable_data() );
+  return ans;
+}
+
+PYBIND11_MODULE( i2c_ads1115, m )
+{
+  pybind11::class_<adc_stats>( m, "adc_stats" )
+    .def_readonly( "n", &adc_stats::n )
+    .def_readonly( "latest", &adc_stats::latest )
+    .def_readonly( "age", &adc_stats::age )
+    .def_readonly( "mean", &adc_stats::mean )
+    .def_readonly( "stddev", &adc_stats::stddev )
+    .def_readonly( "min", &adc_stats::min )
+    .def_readonly( "max", &adc_stats::max );
+
+  pybind11::class_<i2c_ads1115>( m, "i2c_ads1115" )
+    .def( pybind11::init<const uint8_t, const uint8_t>() )
+
+    // Read-only methods.
+    .def( "read_mv",
+          &i2c_ads1115::read_mv,
+          "Returning the readout values in mV",
+          pybind11::arg( "channel" ), //
+          pybind11::arg( "range" ),   //
+          pybind11::arg( "rate" ) = i2c_ads1115::ADS_RATE_250SPS,
+          pybind11::call_guard<pybind11::gil_scoped_release>() )
+    .def( "scan",
+          &scan,
+          "Reading multiple samples of multiple channels in a single call in mV",
+          pybind11::arg( "channels" ),
+          pybind11::arg( "range" ),
+          pybind11::arg( "rate" )      = i2c_ads1115::ADS_RATE_250SPS,
+          pybind11::arg( "n_samples" ) = unsigned( 1 ),
+          pybind11::arg( "average" )   = true )
+
+    // Background sampling
+    .def( "start_sampler",
+          &i2c_ads1115::start_sampler,
+          "Starting a background thread cycling through the listed channels",
+          pybind11::arg( "channels" ),
+          pybind11::arg( "ranges" ),
+          pybind11::arg( "rate" )     = i2c_ads1115::ADS_RATE_860SPS,
+          pybind11::arg( "capacity" ) = unsigned( 1024 ),
+          pybind11::call_guard<pybind11::gil_scoped_release>() )
+    .def( "stop_sampler", &i2c_ads1115::stop_sampler, pybind11::call_guard<pybind11::gil_scoped_release>() )
+    .def( "sampler_running", &i2c_ads1115::sampler_running )
+    .def( "sampler_errors", &i2c_ads1115::sampler_errors )
+    .def( "reset_stats", &i2c_ads1115::reset_stats )
+    .def( "latest", &i2c_ads1115::latest, "Latest sampled value in mV", pybind11::arg( "channel" ) )
+    .def( "summary",
+          &i2c_ads1115::summary,
+          "Summary statistics of the sampled values",
+          pybind11::arg( "channel" ),
+          pybind11::arg( "window" ) = unsigned( 0 ) )
+    .def( "history", &history, "Sampled values in the ring buffer", pybind11::arg( "channel" ) )
+    .def_static( "conversion_us",
+                 &i2c_ads1115::conversion_us,
+                 "Nominal conversion time at a rate setting in microseconds",
+                 pybind11::arg( "rate" ) )
+
+    // All static variables are read-only
+    .def_readonly_static( "ADS_RANGE_6V", &i2c_ads1115::ADS_RANGE_6V )
+    .def_readonly_static( "ADS_RANGE_4V", &i2c_ads1115::ADS_RANGE_4V )
+    .def_readonly_static( "ADS_RANGE_2V", &i2c_ads1115::ADS_RANGE_2V )
+    .def_readonly_static( "ADS_RANGE_1V", &i2c_ads1115::ADS_RANGE_1V )
+    .def_readonly_static( "ADS_RANGE_p5V", &i2c_ads1115::ADS_RANGE_p5V )
+    .def_readonly_static( "ADS_RANGE_p25V", &i2c_ads1115::ADS_RANGE_p25V )
+    .def_readonly_static( "ADS_RATE_8SPS", &i2c_ads1115::ADS_RATE_8SPS )
+    .def_readonly_static( "ADS_RATE_16SPS", &i2c_ads1115::ADS_RATE_16SPS )
+    .def_readonly_static( "ADS_RATE_32SPS", &i2c_ads1115::ADS_RATE_32SPS )
+    .def_readonly_static( "ADS_RATE_64SPS", &i2c_ads1115::ADS_RATE_64SPS )
+    .def_readonly_static( "ADS_RATE_128SPS", &i2c_ads1115::ADS_RATE_128SPS )
+    .def_readonly_static( "ADS_RATE_250SPS", &i2c_ads1115::ADS_RATE_250SPS )
+    .def_readonly_static( "ADS_RATE_475SPS", &i2c_ads1115::ADS_RATE_475SPS )
+    .def_readonly_static( "ADS_RATE_860SPS", &i2c_ads1115::ADS_RATE_860SPS );
+}
@@ -0,0 +1,174 @@
+#include "i2c_bus.hpp"
+
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <linux/i2c-dev.h>
+#include <map>
+#include <sys/ioctl.h>
+
+namespace hw {
+
+/**
+ * @brief Getting the shared instance of a bus, opening the bus if no device is
+ * currently using it. The bus is closed once all devices using it are
+ * destroyed.
+ */
+std::shared_ptr<i2c_bus>
+i2c_bus::get( const uint8_t bus_id )
+{
+  static std::mutex                                  registry_mutex;
+  static std::map<uint8_t, std::weak_ptr<i2c_bus> > registry;
+
+  std::lock_guard<std::mutex> lock( registry_mutex );
+  std::shared_ptr<i2c_bus>    bus = registry[bus_id].lock();
+  if( !bus ) {
+    bus              = std::shared_ptr<i2c_bus>( new i2c_bus( bus_id ) );
+    registry[bus_id] = bus;
+  }
+  return bus;
+}
+
+/**
+ * @brief Opening the bus file descriptor. As other processes may also access
+ * the bus, the file descriptor is not locked.
+ */
+i2c_bus::i2c_bus( const uint8_t bus_id )
+  : fd_accessor( fmt::format( "i2c-{0:d}", bus_id ),       //
+                 fmt::format( "/dev/i2c-{0:d}", bus_id ), //
+                 fd_accessor::MODE::READ_WRITE,
+                 false )
+  , _combining( false )
+  , _n_transfer( 0 )
+  , _n_ioctl( 0 )
+{}
+
+i2c_bus::~i2c_bus() {}
+
+/**
+ * @brief Performing a transaction of n messages on the bus. The transaction may
+ * be combined with transactions requested by other threads. Returns 0 on
+ * success, or the errno value of the failed ioctl call.
+ */
+int
+i2c_bus::transfer( struct i2c_msg* msgs, const unsigned n )
+{
+  if( n == 0 || n > max_msgs ) {
+    return EINVAL;
+  }
+  _n_transfer++;
+
+  request                      req = { msgs, n, 0, false };
+  std::unique_lock<std::mutex> lock( _mutex );
+  _pending.push_back( &req );
+  while( !req.done ) {
+    if( _combining ) {
+      _cv.wait( lock );
+    } else {
+      combine( lock );
+    }
+  }
+  return req.error;
+}
+
+/**
+ * @brief Performing the queued transactions, must be called with the lock
+ * held. The lock is released during the ioctl calls, so other threads can
+ * continue queuing transactions.
+ */
+void
+i2c_bus::combine( std::unique_lock<std::mutex>& lock )
+{
+  _combining = true;
+  std::vector<request*>       batch;
+  std::vector<struct i2c_msg> msgs;
+  bool                        has_read = false;
+  while( !has_read && !_pending.empty() && msgs.size() + _pending.front()->n <= max_msgs ) {
+    request* req = _pending.front();
+    _pending.pop_front();
+    batch.push_back( req );
+    msgs.insert( msgs.end(), req->msgs, req->msgs + req->n );
+    // No further messages can follow a read message
+    has_read = std::any_of( req->msgs, req->msgs + req->n, []( const struct i2c_msg& m ) {
+      return m.flags & I2C_M_RD;
+    } );
+  }
+  lock.unlock();
+
+  // Writes before the failing message may already have been performed, so the
+  // transactions are not repeated (ex: repeating a conversion start)
+  const int error = rdwr( msgs.data(), msgs.size() );
+  for( request* req : batch ) {
+    req->error = error;
+  }
+
+  lock.lock();
+  for( request* req : batch ) {
+    req->done = true;
+  }
+  _combining = false;
+  _cv.notify_all();
+}
+
+int
+i2c_bus::rdwr( struct i2c_msg* msgs, const unsigned n )
+{
+  struct i2c_rdwr_ioctl_data data = { msgs, n };
+  _n_ioctl++;
+  return ioctl( _fd, I2C_RDWR, &data ) < 0 ? errno : 0;
+}
+
+/**
+ * @brief The device will not have its own file descriptor, only the shared bus
+ * instance.
+ */
+i2c_device::i2c_device( const std::string& dev_name, const uint8_t bus_id, const uint8_t dev_id )
+  : fd_accessor( dev_name )
+  , _bus( i2c_bus::get( bus_id ) )
+  , _dev_id( dev_id )
+{
+  _dev_path = _bus->_dev_path;
+}
+
+/**
+ * @brief Performing a transaction of messages on the bus, raising an error if
+ * the transaction failed. The address of the messages should already be set.
+ */
+void
+i2c_device::transfer( struct i2c_msg* msgs, const unsigned n ) const
+{
+  const int error = _bus->transfer( msgs, n );
+  if( error ) {
+    raise_error( fmt::format( "Failed I2C transaction on [{0:s}@{1:#x}]: {2:s}", //
+                              _dev_path,
+                              _dev_id,
+                              std::strerror( error ) ) );
+  }
+}
+
+/**
+ * @brief Writing the bytes to the device as a single message.
+ */
+void
+i2c_device::write_msg( const std::vector<uint8_t>& message ) const
+{
+  std::vector<uint8_t> buf = message;
+  struct i2c_msg       msg = { _dev_id, 0, uint16_t( buf.size() ), buf.data() };
+  transfer( &msg, 1 );
+}
+
+/**
+ * @brief Reading n bytes from the device as a single message.
+ */
+std::vector<uint8_t>
+i2c_device::read_msg( const unsigned n ) const
+{
+  std::vector<uint8_t> buf( n );
+  struct i2c_msg       msg = { _dev_id, I2C_M_RD, uint16_t( n ), buf.data() };
+  transfer( &msg, 1 );
+  return buf;
+}
+
+}
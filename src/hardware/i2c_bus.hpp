@@ -0,0 +1,108 @@
+/**
+ * @file i2c_bus.hpp
+ * @author Yi-Mu Chen
+ * @brief Shared access to the I2C buses for multiple devices.
+ */
+#ifndef GANTRYMQ_I2C_BUS_HPP
+#define GANTRYMQ_I2C_BUS_HPP
+
+#include "sysfs.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <linux/i2c.h>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace hw {
+
+/**
+ * @brief Single file descriptor for an I2C bus, shared by all devices on the
+ * bus within the process.
+ *
+ * @details Instances are obtained with i2c_bus::get, such that all devices on
+ * the same bus share the same instance regardless of which python module the
+ * device is defined in. Transactions are performed with the I2C_RDWR ioctl,
+ * where each message carries the target device address, so no slave address
+ * selection state is kept on the file descriptor.
+ *
+ * Transactions are serialized using flat-combining: transactions requested
+ * while another thread is performing the ioctl call are queued, and the next
+ * thread to obtain the bus performs the queued transactions as a single
+ * I2C_RDWR call (up to the kernel limit on the number of messages). Each
+ * transaction is still performed as a contiguous sequence of messages. As some
+ * bus drivers (ex: i2c-bcm2835 on the Raspberry Pi) only accept a read message
+ * as the last message of a call, a transaction containing a read message ends
+ * the combined call, and the remaining transactions are performed by the
+ * following calls. If a combined call fails, it is not known which of the
+ * messages were already performed, so the transactions are not repeated, and
+ * the failure is reported to all transactions of the call.
+ */
+class i2c_bus : public fd_accessor
+{
+public:
+  // Limit on the number of messages in a single I2C_RDWR call
+  static constexpr unsigned max_msgs = 42;
+
+  static std::shared_ptr<i2c_bus> get( const uint8_t bus_id );
+
+  i2c_bus( const i2c_bus& ) = delete;
+  ~i2c_bus();
+
+  int transfer( struct i2c_msg* msgs, const unsigned n );
+
+  // Statistics for monitoring the combining efficiency
+  unsigned long transfer_count() const { return _n_transfer; }
+  unsigned long ioctl_count() const { return _n_ioctl; }
+
+private:
+  explicit i2c_bus( const uint8_t bus_id );
+
+  struct request
+  {
+    struct i2c_msg* msgs;
+    unsigned        n;
+    int             error;
+    bool            done;
+  };
+
+  std::mutex              _mutex;
+  std::condition_variable _cv;
+  std::deque<request*>    _pending;
+  bool                    _combining;
+
+  std::atomic<unsigned long> _n_transfer;
+  std::atomic<unsigned long> _n_ioctl;
+
+  int  rdwr( struct i2c_msg* msgs, const unsigned n );
+  void combine( std::unique_lock<std::mutex>& lock );
+};
+
+/**
+ * @brief Base class for devices on a shared I2C bus.
+ *
+ * @details The file descriptor of the device itself is not used, only the
+ * device name for the logging methods. The transaction methods raise an
+ * exception if the transaction fails.
+ */
+class i2c_device : public fd_accessor
+{
+public:
+  i2c_device( const std::string& dev_name, const uint8_t bus_id, const uint8_t dev_id );
+
+  void                 transfer( struct i2c_msg* msgs, const unsigned n ) const;
+  void                 write_msg( const std::vector<uint8_t>& message ) const;
+  std::vector<uint8_t> read_msg( const unsigned n ) const;
+
+protected:
+  std::shared_ptr<i2c_bus> _bus;
+  const uint8_t            _dev_id;
+};
+
+}
+
+#endif
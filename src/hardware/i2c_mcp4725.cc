@@ -1,50 +1,16 @@
-#include "sysfs.hpp"
+#include "i2c_mcp4725.hpp"
 #include "threadsleep.hpp"
 
-#include <fcntl.h>
+#include <algorithm>
 #include <fmt/core.h>
-#include <linux/i2c-dev.h>
-#include <stdint.h>
-#include <sys/ioctl.h>
-
-#include <pybind11/pybind11.h>
 
 /**
- * @brief Specialized interactions with the MCP4725DAC chip over an I2C.
- *
- * @details Write only device with only 1 channel
- */
-class i2c_mcp4725 : private hw::fd_accessor
-{
-public:
-  // Default constructor and destructor
-  i2c_mcp4725( const uint8_t bus_id, const uint8_t dev_id );
-  i2c_mcp4725( const i2c_mcp4725& )  = delete;
-  i2c_mcp4725( const i2c_mcp4725&& ) = delete;
-  ~i2c_mcp4725();
-
-  void set_int( const uint16_t val ) const;
-  int  read_int() const;
-};
-
-/**
- * @brief Opening the file descriptor. Notice that because all devices on the
- * same I2C bus uses the same file descriptor, we will *not* lock the file
- * descriptor. But we will need to add an additional I2C device operations to
- * the file descriptor.
+ * @brief Registering the device on the shared I2C bus. As no slave address
+ * selection is needed, nothing is sent to the device at construction.
  */
 i2c_mcp4725::i2c_mcp4725( const uint8_t bus_id, const uint8_t dev_id )
-  :                                                                        //
-  hw::fd_accessor( fmt::format( "ads1115@{0:#x}:{1:#x}", bus_id, dev_id ), //
-                   fmt::format( "/dev/i2c-{0:d}", bus_id ),                //
-                   hw::fd_accessor::MODE::READ_WRITE,
-                   false )
-{
-  // connect to ADS1115 as i2c slave
-  if( ioctl( _fd, I2C_SLAVE, dev_id ) == -1 ) {
-    this->close_with_error( fmt::format( "Error: Couldn't access i2c [{0:d}@{:d}]!", _dev_name, dev_id ) );
-  }
-}
+  : hw::i2c_device( fmt::format( "mcp4725@{0:#x}:{1:#x}", bus_id, dev_id ), bus_id, dev_id )
+{}
 
 /**
  * @brief Setting via 12 bit integer value
@@ -61,22 +27,50 @@ i2c_mcp4725::set_int( const uint16_t value ) const
   const uint8_t byte_2 = ( ( value & 0b000000001111 ) << 4 ); // Must be shifted by 4
   //const uint8_t byte_3 = 0; // Must be shifted by 4
 
-  this->write( std::vector<uint8_t>( { byte_0, byte_1, byte_2 } ) );
+  this->write_msg( std::vector<uint8_t>( { byte_0, byte_1, byte_2 } ) );
 }
 
 int
 i2c_mcp4725::read_int() const
 {
-  const std::vector<uint8_t> v = this->read_bytes( 3 );
+  const std::vector<uint8_t> v = this->read_msg( 3 );
   return ( int( v[1] ) << 4 ) | ( int( v[2] ) >> 4 );
 }
 
-i2c_mcp4725::~i2c_mcp4725() {}
-
-PYBIND11_MODULE( i2c_mcp4725, m )
+/**
+ * @brief Sending a sequence of values to the DAC with a fixed update period in
+ * microseconds. Returns the time taken for the sequence in seconds.
+ *
+ * @details The values are sent using the 2-byte fast-mode write command, with
+ * the timing handled by a C++ loop with the GIL released. A single transaction
+ * takes roughly 300us on a 100kHz bus, so if the requested period is shorter
+ * than min_period_us, consecutive updates are grouped as repeated fast-mode
+ * writes in the same I2C message, in which case the updates within a group are
+ * spaced by the bus clock (~180us per update at 100kHz) rather than the
+ * requested period. Periods shorter than the bus time will simply run as fast
+ * as the bus allows. The start of each group is scheduled on the requested
+ * period, so timing errors do not accumulate.
+ */
+double
+i2c_mcp4725::ramp( const std::vector<uint16_t>& values, const unsigned period_us ) const
 {
-  pybind11::class_<i2c_mcp4725>( m, "i2c_mcp4725" )
-    .def( pybind11::init<const uint8_t, const uint8_t>() )
-    .def( "set_int", &i2c_mcp4725::set_int, "Setting the output voltage (int)", pybind11::arg( "value" ) )
-    .def( "read_int", &i2c_mcp4725::read_int, "readout int int value" );
+  const size_t group = std::max<size_t>( 1, ( min_period_us + period_us - 1 ) / std::max( period_us, 1u ) );
+
+  // Fast-mode write command: 0 0 PD1 PD0 D11 D10 D9 D8 | D7 ... D0
+  std::vector<uint8_t> buf( 2 * values.size() );
+  for( size_t i = 0; i < values.size(); ++i ) {
+    buf[2 * i]     = ( values[i] >> 8 ) & 0x0F;
+    buf[2 * i + 1] = values[i] & 0xFF;
+  }
+
+  const int64_t start = hw::monotonic_ns();
+  for( size_t i = 0; i < values.size(); i += group ) {
+    const size_t   n   = std::min( group, values.size() - i );
+    struct i2c_msg msg = { _dev_id, 0, uint16_t( 2 * n ), buf.data() + 2 * i };
+    hw::sleep_until_ns( start + int64_t( i ) * period_us * 1000 );
+    transfer( &msg, 1 );
+  }
+  return ( hw::monotonic_ns() - start ) * 1e-9;
 }
+
+i2c_mcp4725::~i2c_mcp4725() {}
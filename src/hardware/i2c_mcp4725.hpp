@@ -0,0 +1,39 @@
+/**
+ * @file i2c_mcp4725.hpp
+ * @author Yi-Mu Chen
+ * @brief Interface to the MCP4725 DAC chip, shared by the python modules that
+ * operate the DAC.
+ */
+#ifndef GANTRYMQ_I2C_MCP4725_HPP
+#define GANTRYMQ_I2C_MCP4725_HPP
+
+#include "i2c_bus.hpp"
+
+#include <stdint.h>
+#include <vector>
+
+/**
+ * @brief Specialized interactions with the MCP4725DAC chip over an I2C.
+ *
+ * @details Write only device with only 1 channel. The device is accessed
+ * through the I2C bus shared with other devices.
+ */
+class i2c_mcp4725 : private hw::i2c_device
+{
+public:
+  // Default constructor and destructor
+  i2c_mcp4725( const uint8_t bus_id, const uint8_t dev_id );
+  i2c_mcp4725( const i2c_mcp4725& )  = delete;
+  i2c_mcp4725( const i2c_mcp4725&& ) = delete;
+  ~i2c_mcp4725();
+
+  void   set_int( const uint16_t val ) const;
+  int    read_int() const;
+  double ramp( const std::vector<uint16_t>& values, const unsigned period_us ) const;
+
+  // Shortest update period (in microseconds) for each update to be sent as a
+  // separate transaction.
+  static constexpr unsigned min_period_us = 400;
+};
+
+#endif
@@ -0,0 +1,19 @@
+#include "i2c_mcp4725.hpp"
+
+#include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
+
+PYBIND11_MODULE( i2c_mcp4725, m )
+{
+  pybind11::class_<i2c_mcp4725>( m, "i2c_mcp4725" )
+    .def( pybind11::init<const uint8_t, const uint8_t>() )
+    .def( "set_int", &i2c_mcp4725::set_int, "Setting the output voltage (int)", pybind11::arg( "value" ) )
+    .def( "read_int", &i2c_mcp4725::read_int, "readout int int value" )
+    .def( "ramp",
+          &i2c_mcp4725::ramp,
+          "Sending a sequence of int values with a fixed update period (us)",
+          pybind11::arg( "values" ),
+          pybind11::arg( "period_us" ),
+          pybind11::call_guard<pybind11::gil_scoped_release>() )
+    .def_readonly_static( "min_period_us", &i2c_mcp4725::min_period_us );
+}
@@ -0,0 +1,83 @@
+/**
+ * @file spsc_ring.hpp
+ * @author Yi-Mu Chen
+ * @brief Lock-free single-producer, single-consumer ring buffer of fixed size
+ * records.
+ */
+#ifndef GANTRYMQ_SPSC_RING_HPP
+#define GANTRYMQ_SPSC_RING_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+namespace hw {
+
+/**
+ * @brief Ring buffer for passing fixed-length records of type T from exactly
+ * one producer thread to exactly one consumer thread without locks.
+ *
+ * Records are written in place: the producer requests a pointer to the next
+ * free record with write_slot (nullptr if the ring is full), fills the record,
+ * then publishes it with commit_write. The consumer does the same with
+ * read_slot and commit_read. The storage is allocated once at construction.
+ * The head and tail indices are placed on separate cache lines to avoid false
+ * sharing between the two threads.
+ */
+template<typename T>
+class spsc_ring
+{
+public:
+  spsc_ring( const size_t capacity, const size_t record_size )
+    : _capacity( capacity )
+    , _record_size( record_size )
+    , _storage( capacity * record_size )
+    , _head( 0 )
+    , _tail( 0 )
+  {}
+
+  // Producer side
+  T*
+  write_slot()
+  {
+    const size_t head = _head.load( std::memory_order_relaxed );
+    if( head - _tail.load( std::memory_order_acquire ) >= _capacity ) {
+      return nullptr;
+    }
+    return _storage.data() + ( head % _capacity ) * _record_size;
+  }
+  void commit_write() { _head.fetch_add( 1, std::memory_order_release ); }
+
+  // Consumer side
+  const T*
+  read_slot() const
+  {
+    const size_t tail = _tail.load( std::memory_order_relaxed );
+    if( _head.load( std::memory_order_acquire ) == tail ) {
+      return nullptr;
+    }
+    return _storage.data() + ( tail % _capacity ) * _record_size;
+  }
+  void commit_read() { _tail.fetch_add( 1, std::memory_order_release ); }
+
+  // Either side
+  size_t
+  size() const
+  {
+    const size_t tail = _tail.load( std::memory_order_acquire );
+    return _head.load( std::memory_order_acquire ) - tail;
+  }
+  size_t capacity() const { return _capacity; }
+  size_t record_size() const { return _record_size; }
+
+private:
+  const size_t        _capacity;
+  const size_t        _record_size;
+  std::vector<T>      _storage;
+  alignas( 64 ) std::atomic<size_t> _head; /** Number of records written */
+  alignas( 64 ) std::atomic<size_t> _tail; /** Number of records read */
+};
+
+}
+
+#endif
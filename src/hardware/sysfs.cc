@@ -4,7 +4,10 @@
 #include <fmt/core.h>
 
 // For /sys filesystem interactions
+#include <cerrno>
+#include <cstring>
 #include <fcntl.h>
+#include <poll.h>
 #include <sys/file.h>
 #include <sys/stat.h>
 #include <sys/types.h>
@@ -31,6 +34,8 @@ namespace hw {
  * [ref]: https://stackoverflow.com/questions/1599459/optimal-lock-file-method
  */
 fd_accessor::fd_accessor( const std::string& dev_name, const std::string& dev_path, const int mode, const bool lock )
+  : _rx_begin( 0 )
+  , _rx_end( 0 )
 {
   this->_dev_name = dev_name;
   this->_dev_path = dev_path;
@@ -48,6 +53,20 @@ fd_accessor::fd_accessor( const std::string& dev_name, const std::string& dev_pa
   }
 }
 
+/**
+ * @brief Instance without a file descriptor, for devices that are accessed
+ * through some other shared resource, but still want to use the logging
+ * methods.
+ */
+fd_accessor::fd_accessor( const std::string& dev_name )
+  : _dev_name( dev_name )
+  , _dev_path( "" )
+  , _fd( -1 )
+  , _mode( 0 )
+  , _rx_begin( 0 )
+  , _rx_end( 0 )
+{}
+
 /**
  * @brief Boolean flag of whether the file descriptor is currently valid.
  */
@@ -145,24 +164,15 @@ fd_accessor::write_raw( const char* message, const int n ) const
  * User can specific a length to read. If not provided, then we simply read
  * however much is available at the file descriptor. If the read length is
  * provided, then we also check the return string length for it to ensure that
- * the matches the expected string length.
+ * the matches the expected string length. Bytes left over in the receive
+ * buffer by the buffered read methods are always returned first.
  */
 std::string
 fd_accessor::read_str( const unsigned n ) const
 {
-  static constexpr uint16_t buf_size = 65535;
-
-  this->check_valid();
-  char      buffer[buf_size] = {};
-  const int readlen          = ( n == 0 ) ? //
-                        ::read( this->_fd, buffer, sizeof( buffer ) - 1 )
-                                          : //
-                        ::read( this->_fd, buffer, n );
-
-  if( ( n > 0 ) && ( readlen != (int)n ) ) {
-    raise_error( fmt::format( "mismatch message length. Expected [{0:d}], got [{1:d}]", n, readlen ) );
-  }
-  return std::string( buffer, buffer + readlen );
+  std::string ans;
+  read_into( ans, n );
+  return ans;
 }
 
 /**
@@ -171,8 +181,174 @@ fd_accessor::read_str( const unsigned n ) const
 std::vector<uint8_t>
 fd_accessor::read_bytes( const unsigned n ) const
 {
-  const std::string read_str = this->read_str( n );
-  return std::vector<uint8_t>( read_str.begin(), read_str.end() );
+  std::vector<uint8_t> ans;
+  read_into( ans, n );
+  return ans;
+}
+
+/**
+ * @brief Common implementation of the unbuffered read methods.
+ *
+ * Fixed length reads are performed directly into the output container. For
+ * reads of unknown length, the single read is performed into the persistent
+ * receive buffer, so that no large temporary buffer needs to be allocated (and
+ * cleared) for every call.
+ */
+template <typename T>
+void
+fd_accessor::read_into( T& out, const unsigned n ) const
+{
+  static constexpr size_t buf_size = 65536;
+
+  this->check_valid();
+  const size_t buffered = _rx_end - _rx_begin;
+  if( n == 0 ) {
+    if( buffered == 0 ) {
+      _rx_begin = _rx_end = 0;
+      _rx_buffer.resize( std::max( _rx_buffer.size(), buf_size ) );
+      const ssize_t readlen = ::read( this->_fd, _rx_buffer.data(), _rx_buffer.size() );
+      _rx_end               = std::max( readlen, ssize_t( 0 ) );
+    }
+    out.assign( _rx_buffer.data() + _rx_begin, _rx_buffer.data() + _rx_end );
+    _rx_begin = _rx_end = 0;
+    return;
+  }
+
+  const size_t taken = std::min( buffered, size_t( n ) );
+  out.resize( n );
+  std::memcpy( out.data(), _rx_buffer.data() + _rx_begin, taken );
+  _rx_begin += taken;
+
+  const ssize_t readlen = ( taken < n ) ? ::read( this->_fd, out.data() + taken, n - taken ) : 0;
+  const size_t  received = taken + std::max( readlen, ssize_t( 0 ) );
+  if( received != n ) {
+    raise_error( fmt::format( "mismatch message length. Expected [{0:d}], got [{1:d}]", n, received ) );
+  }
+}
+
+/**
+ * @brief Reading from the file descriptor up to and including the delimiter
+ * character.
+ *
+ * Bytes are read into a persistent receive buffer owned by the instance, and
+ * are only removed from the buffer once a complete delimited message has been
+ * extracted. Partial messages split across multiple reads will therefore be
+ * kept between function calls, and no allocation is required once the buffer
+ * has reached its working size. The thread is suspended using `poll` until new
+ * bytes arrive at the file descriptor, so the delimited message is returned as
+ * soon as it arrives.
+ *
+ * The output string will contain the message without the delimiter. Returns
+ * false if no complete message is received within the timeout (in units of
+ * microseconds), in which case the partial message is kept in the buffer.
+ */
+bool
+fd_accessor::read_until( std::string& out, const char delim, const unsigned timeout ) const
+{
+  using namespace std::chrono;
+  const steady_clock::time_point deadline = steady_clock::now() + microseconds( timeout );
+
+  this->check_valid();
+  for( size_t scanned = 0;; ) {
+    const char* begin = _rx_buffer.data() + _rx_begin;
+    const char* found = (const char*)std::memchr( begin + scanned, delim, _rx_end - _rx_begin - scanned );
+    if( found != nullptr ) {
+      out.assign( begin, found );
+      _rx_begin += ( found - begin ) + 1;
+      return true;
+    }
+    scanned = _rx_end - _rx_begin;
+    if( fill_rx( deadline ) == 0 ) {
+      return false;
+    }
+  }
+}
+
+/**
+ * @brief Reading a single newline-terminated line from the file descriptor.
+ *
+ * Identical to read_until with newline character as the delimiter, except the
+ * trailing carriage return character will also be stripped, if it exists.
+ */
+bool
+fd_accessor::read_line( std::string& out, const unsigned timeout ) const
+{
+  if( !read_until( out, '\n', timeout ) ) {
+    return false;
+  }
+  if( !out.empty() && out.back() == '\r' ) {
+    out.pop_back();
+  }
+  return true;
+}
+
+/**
+ * @brief Discarding all bytes stored in the receive buffer.
+ */
+void
+fd_accessor::clear_rx() const
+{
+  _rx_begin = _rx_end = 0;
+}
+
+/**
+ * @brief Reading whatever is available at the file descriptor into the
+ * receive buffer, waiting until the deadline for the bytes to arrive.
+ *
+ * Unconsumed bytes are moved to the front of the buffer when the buffer end is
+ * reached, and the buffer is only grown if the unconsumed bytes fill the
+ * entire buffer. Returns the number of bytes read, 0 if nothing was received
+ * before the deadline, or if the end of file is reached. An exception is
+ * raised if the device hangs up or is in an error state (ex: the USB serial
+ * device is disconnected), or if the read fails for any reason other than no
+ * data being available, rather than retrying until the deadline.
+ */
+size_t
+fd_accessor::fill_rx( const std::chrono::steady_clock::time_point deadline ) const
+{
+  using namespace std::chrono;
+  static constexpr size_t min_size = 4096;
+
+  if( _rx_begin == _rx_end ) {
+    _rx_begin = _rx_end = 0;
+  }
+  if( _rx_end == _rx_buffer.size() ) {
+    if( _rx_begin > 0 ) {
+      std::memmove( _rx_buffer.data(), _rx_buffer.data() + _rx_begin, _rx_end - _rx_begin );
+      _rx_end -= _rx_begin;
+      _rx_begin = 0;
+    } else {
+      _rx_buffer.resize( std::max( 2 * _rx_buffer.size(), min_size ) );
+    }
+  }
+
+  struct pollfd pfd = { this->_fd, POLLIN, 0 };
+  while( true ) {
+    const long remain = ceil<milliseconds>( deadline - steady_clock::now() ).count();
+    const int  ready  = poll( &pfd, 1, std::max( remain, 0L ) );
+    if( ready < 0 && errno != EINTR ) {
+      raise_error( fmt::format( "Failed to poll file descriptor: {0:s}", std::strerror( errno ) ) );
+    }
+    // Bytes still available are read even if the device has hung up
+    const bool hangup = ready > 0 && ( pfd.revents & ( POLLHUP | POLLERR | POLLNVAL ) );
+    if( ready > 0 && ( pfd.revents & POLLIN ) ) {
+      const ssize_t n = ::read( this->_fd, _rx_buffer.data() + _rx_end, _rx_buffer.size() - _rx_end );
+      if( n > 0 ) {
+        _rx_end += n;
+        return n;
+      } else if( n == 0 && !hangup ) {
+        return 0;
+      } else if( n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR ) {
+        raise_error( fmt::format( "Failed to read from file descriptor: {0:s}", std::strerror( errno ) ) );
+      }
+    }
+    if( hangup ) {
+      raise_error( "File descriptor was hung up or is in an error state" );
+    }
+    if( remain <= 0 ) {
+      return 0;
+    }
+  }
 }
 
 /**
@@ -208,6 +384,10 @@ static PyObject* logging_lib = PyImport_ImportModuleNoBlock( "logging" );
  * formatting at user level. The function used is modified from here:
  * https://kalebporter.medium.com/logging-extending-python-with-c-or-c-fa746466b602
  *
+ * As the logging methods can be called by functions that have released the
+ * GIL, or by threads not started by python, the GIL is explicitly acquired for
+ * the duration of the python calls.
+ *
  * @param name The name of the sublogger to use.
  * @param level The info level
  * @param message The message string
@@ -215,12 +395,14 @@ static PyObject* logging_lib = PyImport_ImportModuleNoBlock( "logging" );
 static void
 logger_wrapped( const std::string& device, int level, const std::string& message )
 {
-  PyObject* logging_name = Py_BuildValue( "s", fmt::format( "GantryMQ.{0:s}", device ).c_str() );
-  PyObject* logging_args = Py_BuildValue( "(is)", level, message.c_str() );
-  PyObject* logging_obj  = PyObject_CallMethod( logging_lib, "getLogger", "O", logging_name );
+  const PyGILState_STATE gil_state    = PyGILState_Ensure();
+  PyObject*              logging_name = Py_BuildValue( "s", fmt::format( "GantryMQ.{0:s}", device ).c_str() );
+  PyObject*              logging_args = Py_BuildValue( "(is)", level, message.c_str() );
+  PyObject*              logging_obj  = PyObject_CallMethod( logging_lib, "getLogger", "O", logging_name );
   PyObject_CallMethod( logging_obj, "log", "O", logging_args );
   Py_DECREF( logging_name );
   Py_DECREF( logging_args );
+  PyGILState_Release( gil_state );
 }
 
 void
@@ -1,6 +1,7 @@
-#ifndef GANTRYMY_SYSFS_HPP
+#ifndef GANTRYMQ_SYSFS_HPP
 #define GANTRYMQ_SYSFS_HPP
 
+#include <chrono>
 #include <cstdint>
 #include <string>
 #include <sys/file.h>
@@ -31,6 +32,8 @@ public:
   int         _mode;
   // Constructor, effectively the open method
   fd_accessor( const std::string& dev_name, const std::string& path, const int mode, const bool lock = true );
+  // Constructor for devices without a file descriptor, only using the logging methods
+  explicit fd_accessor( const std::string& dev_name );
 
   // which checking of if the file descriptor is valid or not
   void check_valid() const;
@@ -43,6 +46,11 @@ public:
   std::vector<uint8_t> read_bytes( const unsigned n = 0 ) const;
   std::string          read_str( const unsigned n = 0 ) const;
 
+  // Buffered reads for line-oriented devices, timeout in units of microseconds
+  bool read_until( std::string& out, const char delim, const unsigned timeout ) const;
+  bool read_line( std::string& out, const unsigned timeout ) const;
+  void clear_rx() const;
+
   int write_raw( const char* message, const int len ) const;
   // Destructor, effectively the close method
   ~fd_accessor();
@@ -66,6 +74,16 @@ public:
   /** @} */
 
   void raise_error( const std::string& x ) const;
+
+private:
+  // Persistent receive buffer, unconsumed bytes are stored in [begin, end)
+  mutable std::vector<char> _rx_buffer;
+  mutable size_t            _rx_begin;
+  mutable size_t            _rx_end;
+
+  size_t fill_rx( const std::chrono::steady_clock::time_point deadline ) const;
+  template <typename T>
+  void read_into( T& out, const unsigned n ) const;
 };
 
 }
@@ -8,8 +8,14 @@
 #define GANTRYMQ_THREADSLEEP_HPP
 
 #include <chrono>
+#include <cstdint>
 #include <thread>
 
+// For precise suspension and real-time scheduling
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+
 namespace hw {
 
 inline void
@@ -21,21 +27,109 @@ sleep_nanoseconds( const unsigned x )
 inline void
 sleep_microseconds( const unsigned x )
 {
-  std::this_thread::sleep_for( std::chrono::nanoseconds( x * 1000 ) );
+  std::this_thread::sleep_for( std::chrono::microseconds( x ) );
 }
 
 inline void
 sleep_milliseconds( const unsigned x )
 {
-  std::this_thread::sleep_for( std::chrono::nanoseconds( x * 1000 * 1000 ) );
+  std::this_thread::sleep_for( std::chrono::milliseconds( x ) );
 }
 
 inline void
 sleep_seconds( const unsigned x )
 {
-  std::this_thread::sleep_for( std::chrono::nanoseconds( x * 1000 * 1000 * 1000 ) );
+  std::this_thread::sleep_for( std::chrono::seconds( x ) );
+}
+
+/**
+ * @brief Current time of the monotonic clock in nanoseconds
+ */
+inline int64_t
+monotonic_ns()
+{
+  struct timespec ts;
+  clock_gettime( CLOCK_MONOTONIC, &ts );
+  return int64_t( ts.tv_sec ) * 1000000000 + ts.tv_nsec;
+}
+
+/**
+ * @brief Suspending the thread until the monotonic clock reaches the target
+ * time (in nanoseconds).
+ *
+ * The thread is suspended with an absolute time clock_nanosleep until spin
+ * nanoseconds before the target, and busy-waits for the remainder, such that
+ * the return time is not subjected to the scheduler wake up latency, as long as
+ * the wake up latency is smaller than the spin time.
+ */
+inline void
+sleep_until_ns( const int64_t target, const unsigned spin = 50000 )
+{
+  const int64_t wake = target - spin;
+  if( monotonic_ns() < wake ) {
+    struct timespec ts;
+    ts.tv_sec  = wake / 1000000000;
+    ts.tv_nsec = wake % 1000000000;
+    while( clock_nanosleep( CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr ) ) {} // Retry if interrupted
+  }
+  while( monotonic_ns() < target ) {}
 }
 
+/**
+ * @brief Temporarily running the current thread with real-time priority and/or
+ * pinned to a CPU, restoring the original settings when the object goes out of
+ * scope.
+ *
+ * A priority of 0 keeps the original scheduling policy, otherwise the SCHED_FIFO
+ * policy is used with the given priority. A negative cpu keeps the original
+ * affinity. Failing to apply the settings (typically missing the CAP_SYS_NICE
+ * capability) is not considered an error, use the applied method to check.
+ */
+class realtime_scope
+{
+public:
+  realtime_scope( const int priority, const int cpu )
+    : _sched_set( false )
+    , _affinity_set( false )
+  {
+    const pthread_t self = pthread_self();
+    if( priority > 0 ) {
+      pthread_getschedparam( self, &_policy, &_param );
+      struct sched_param param;
+      param.sched_priority = priority;
+      _sched_set           = ( pthread_setschedparam( self, SCHED_FIFO, &param ) == 0 );
+    }
+    if( cpu >= 0 ) {
+      pthread_getaffinity_np( self, sizeof( cpu_set_t ), &_cpuset );
+      cpu_set_t cpuset;
+      CPU_ZERO( &cpuset );
+      CPU_SET( cpu, &cpuset );
+      _affinity_set = ( pthread_setaffinity_np( self, sizeof( cpu_set_t ), &cpuset ) == 0 );
+    }
+  }
+  ~realtime_scope()
+  {
+    const pthread_t self = pthread_self();
+    if( _sched_set ) {
+      pthread_setschedparam( self, _policy, &_param );
+    }
+    if( _affinity_set ) {
+      pthread_setaffinity_np( self, sizeof( cpu_set_t ), &_cpuset );
+    }
+  }
+  realtime_scope( const realtime_scope& ) = delete;
+
+  bool sched_applied() const { return _sched_set; }
+  bool affinity_applied() const { return _affinity_set; }
+
+private:
+  bool               _sched_set;
+  bool               _affinity_set;
+  int                _policy;
+  struct sched_param _param;
+  cpu_set_t          _cpuset;
+};
+
 }
 
 #endif
@@ -11,6 +11,12 @@ Expected behavior:
 - Starting the DRS scope
 - Running the voltage calibration routine (no output)
 - Printing the time indexing values (length ~100 numpy array)
+- Printing the event rate of collecting 1000 events one at a time, and in a
+  single collect_events call (requires external trigger). When the module is
+  built with GMQ_DRS_MOCK, triggers are simulated.
+- Printing the mean waveform sums of 1000 events for all channels.
+- Printing the event rate of the continuous acquisition mode, and the number of
+  events dropped.
 
 Program will then close nominally. Additional print-outs will be emitting from
 the underlying libusb library:
@@ -18,7 +24,32 @@ the underlying libusb library:
 libusb: warning [libusb_exit] device X.X still referenced
 """)
 
-## Testing the gcoder
-drs_scope = drs()
+## Testing the DRS
+d = drs()
 d.run_calibration()
-d.get_time_slice(0)
+print(d.get_time_slice(0))
+
+## Event rates
+n_events = 1000
+start = time.perf_counter()
+for _ in range(n_events):
+  d.start_collect()
+  while not d.is_ready():
+    pass
+  d.get_waveform(0)
+print(f"Single event collection: {n_events / (time.perf_counter() - start):.1f} Hz")
+
+start = time.perf_counter()
+events = d.collect_events(n_events, [0, 1, 2, 3], timeout=1000000)
+print(f"Batch collection: {n_events / (time.perf_counter() - start):.1f} Hz", events.shape)
+
+sums = d.get_waveformsums(n_events, [0, 1, 2, 3], [(100, 400, 0, 90)], timeout=1000000)
+print("Mean waveform sums:", sums.mean(axis=0))
+
+d.start_continuous([0, 1, 2, 3], capacity=256)
+start, collected = time.perf_counter(), 0
+while collected < n_events:
+  collected += d.drain_events(100, timeout=100000).shape[0]
+print(f"Continuous collection: {collected / (time.perf_counter() - start):.1f} Hz")
+d.stop_continuous()
+print(f"Dropped events: {d.dropped_events()}")
@@ -1,5 +1,11 @@
 import logging
+import os
+import sys
+import termios
 import time
+import tty
+
+import numpy
 from modules.gcoder import gcoder
 
 logging.basicConfig(level=20)
@@ -10,15 +16,111 @@ Expected behavior:
 
 - The gantry will start up and move to home (this can be slow)
 - The gantry will move to position (100, 100, 100)
+- The gantry will move to position (50, 50, 50), and print the final position
 - The gantry will move back to home
+- The average round trip time of a M114 command will be printed, alongside the
+  round trip time of the same command with the previous acknowledgement loop
+  (measured before the gantry is initialized) as the baseline.
+- The gantry will run a short raster path with multiple commands in flight.
+- The gantry will visit a 10x10 grid given in shuffled order, first streamed
+  in a single batch, then stopping at each point to print the arrival position.
+- With the position auto-report enabled, a batch of back and forth motions
+  with dwells is streamed, and the number of position updates received during
+  the batch is checked against the batch duration divided by the report
+  interval.
 
-Program will then close nominally.
+Program will then close nominally. An alternate device path can be given as the
+first argument (such as the path printed by tests/hardware/marlin_sim.py).
 """)
 
+def baseline_round_trip(path, n_cmd, timeout=1.0):
+  """
+  Average M114 round trip using the acknowledgement loop of the original
+  RunGcode: reading every 1 ms until the ok line arrives, then flushing the
+  port by reading every 5 ms until nothing is received. Returns None if the
+  device does not respond.
+  """
+  fd = os.open(path, os.O_RDWR | os.O_NOCTTY | os.O_NONBLOCK)
+  tty.setraw(fd)
+  attr = termios.tcgetattr(fd)
+  attr[4] = attr[5] = termios.B115200
+  termios.tcsetattr(fd, termios.TCSANOW, attr)
+
+  def read_available():
+    try:
+      return os.read(fd, 4096)
+    except BlockingIOError:
+      return b''
+
+  try:
+    start = time.perf_counter()
+    for _ in range(n_cmd):
+      os.write(fd, b"M114\n")
+      termios.tcdrain(fd)
+      reply, deadline = b'', time.perf_counter() + timeout
+      while b'ok' not in reply:
+        if time.perf_counter() > deadline:
+          return None
+        time.sleep(0.001)
+        reply += read_available()
+      while True:
+        time.sleep(0.005)
+        if not read_available():
+          break
+    return (time.perf_counter() - start) / n_cmd
+  finally:
+    os.close(fd)
+
+
+## Baseline per-command latency, the device must be free at this point
+n_cmd = 200
+device = sys.argv[1] if len(sys.argv) > 1 else '/dev/ttyUSB0'
+baseline = baseline_round_trip(device, n_cmd)
+
 ## Testing the gcoder
-g = gcoder('/dev/ttyUSB0')
+g = gcoder(device)
 g.move_to(100, 100, 100)
 while g.in_motion():
   print(f"\r{g.cx:5.1f} {g.cy:5.1f} {g.cz:5.1f}", end='')
   time.sleep(0.1)
 print('Done!')
+print(g.move_to_and_wait(50, 50, 50))
+
+## Per-command latency
+start = time.perf_counter()
+for _ in range(n_cmd):
+  g.run_gcode("M114")
+print(f"M114 round trip: {(time.perf_counter() - start) / n_cmd * 1000:.3f} ms/command")
+if baseline is None:
+  print("M114 round trip (baseline): device did not respond")
+else:
+  print(f"M114 round trip (baseline): {baseline * 1000:.3f} ms/command")
+
+## Streaming a raster path
+path = [f"G0 X{10 + 10 * (i % 5)} Y{10 + 10 * (i // 5)} Z10" for i in range(25)]
+start = time.perf_counter()
+g.run_gcode_batch(path)
+print(f"Raster path submitted in {(time.perf_counter() - start) * 1000:.1f} ms")
+
+## Multi-point trajectory
+grid = numpy.array([(10 + 5 * i, 10 + 5 * j, 5) for i in range(10) for j in range(10)])
+numpy.random.shuffle(grid)
+start = time.perf_counter()
+arrival = g.run_trajectory(grid)
+print(f"Grid trajectory completed in {time.perf_counter() - start:.1f} s")
+print("Maximum deviation:", numpy.max(numpy.abs(arrival - grid)))
+g.run_trajectory(grid[:10], 100, lambda i, x, y, z: print(i, x, y, z))
+
+## Position auto-report while a batch is streaming
+interval = 1
+g.set_auto_report(interval)
+batch = []
+for i in range(10):
+  batch += [f"G0 X{100 * ((i + 1) % 2) + 1} Y1 Z10", "G4 P500"]
+start, count = time.perf_counter(), g.report_count()
+g.run_gcode_batch(batch)
+duration = time.perf_counter() - start
+n_report, n_expected = g.report_count() - count, duration / interval
+g.set_auto_report(0)
+print(f"{n_report} position updates in {duration:.1f} s (expected {n_expected:.1f})")
+assert abs(n_report - n_expected) <= 1, "Position updates do not match the report interval"
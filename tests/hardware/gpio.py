@@ -1,5 +1,6 @@
 import logging
-from modules.gpio import gpio
+import sys
+from modules.gpio import gpio, gpio_bank
 import time
 
 logging.basicConfig(level=20)
@@ -11,16 +12,77 @@ Expected behavior:
 
 - The GPIO pin 21 (physical pin 40) will pulse 100 times. (No stdout output)
 - The GPIO pin 27 (physical pin X) will toggle on for 5 seconds, the toggle off again
+- The toggle rate of pin 21 will be printed with the line requested per
+  operation, and with the line held for the life time of the object.
+- The rising edge jitter of a 10 us period pulse train on pin 21 will be
+  printed, with and without real-time scheduling (requires root).
+- Pins 20 and 21 will be set and read back as a bank, then pulsed 1000 times in
+  lockstep.
+- Pin 21 will be pulsed 100000 times in the background, with the progress
+  printed while the main thread keeps running, then cancelled half way through
+  a second run.
 
-Program will then close nominally.
+Program will then close nominally. An alternate chip name can be given as the
+first argument, to run the tests against a simulated chip created by the
+gpio-sim kernel module (requires configfs):
+
+  modprobe gpio-sim
+  mkdir -p /sys/kernel/config/gpio-sim/gmq/gpio-bank0
+  echo 32 > /sys/kernel/config/gpio-sim/gmq/gpio-bank0/num_lines
+  echo 1 > /sys/kernel/config/gpio-sim/gmq/live
+  cat /sys/kernel/config/gpio-sim/gmq/gpio-bank0/chip_name # Chip name to use
 """
 )
+chip = sys.argv[1] if len(sys.argv) > 1 else "gpiochip0"
 
 ## Testing the GPIO -- A trigger-like pin on GPIO pin 21 (physical pin 40)
-trigger_gpio = gpio(21)
+trigger_gpio = gpio(21, chip)
 trigger_gpio.pulse(1000, 1000)
 
-hv_gpio = gpio(27)
+hv_gpio = gpio(27, chip)
 hv_gpio.write(True)
 time.sleep(5)
 hv_gpio.write(False)
+
+## Toggle rates
+n_toggle = 10000
+for hold in [False, True]:
+    toggle_gpio = gpio(21, chip, hold=hold)
+    start = time.perf_counter()
+    for i in range(n_toggle):
+        toggle_gpio.write(i % 2 == 0)
+    rate = n_toggle / (time.perf_counter() - start)
+    print(f"Toggle rate (hold={hold}): {rate:.0f} toggles/s")
+    del toggle_gpio
+
+## Pulse train timing
+pulse_gpio = gpio(21, chip, hold=True)
+for priority in [0, 50]:
+    report = pulse_gpio.pulse_train(10000, period=10000, high=1000, priority=priority, cpu=3)
+    print(
+        f"Real-time: {report.realtime}",
+        f"Jitter mean/rms/max: {report.jitter_mean:.0f}/{report.jitter_rms:.0f}/{report.jitter_max} ns",
+    )
+    print(f"Jitter histogram ({report.jitter_bin} ns bins):", report.jitter_hist[:20])
+del pulse_gpio
+
+## Multi-line bank
+bank = gpio_bank([20, 21], chip)
+bank.write([1, 0])
+print("Bank values:", bank.read())
+bank.write([0, 0])
+report = bank.pulse_train([0, 1], n=1000, period=10000, high=1000)
+print(f"Lockstep pulse jitter rms: {report.jitter_rms:.0f} ns")
+del bank
+
+## Background pulse trains
+async_gpio = gpio(21, chip, hold=True)
+async_gpio.pulse_async(100000, 10)
+while async_gpio.pulse_status()[0]:
+    print("Background pulse status (running, completed, total):", async_gpio.pulse_status())
+    time.sleep(0.2)
+report = async_gpio.last_pulse_report()
+print(f"Background pulse jitter rms: {report.jitter_rms:.0f} ns")
+async_gpio.pulse_async(100000, 10)
+time.sleep(0.5)
+print("Cancelled after", async_gpio.pulse_cancel(), "pulses")
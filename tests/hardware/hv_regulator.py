@@ -0,0 +1,49 @@
+import logging
+import sys
+import time
+
+from modules.hv_regulator import hv_regulator
+from modules.i2c_ads1115 import i2c_ads1115
+from modules.i2c_mcp4725 import i2c_mcp4725
+
+logging.basicConfig(level=20)
+logger = logging.getLogger("GantryMQ")
+
+print(
+    """
+Expected behavior:
+
+- The HV is regulated to 40V with a slew limit of 20V/s, then stepped to 45V
+  and 35V. For each target the settle time, the final readout and the error RMS
+  are printed.
+- The regulation is then stopped, leaving the control voltage as is.
+
+By default, a simulated HV module is used. Pass "hw" as the first argument to
+use the HV DAC at 0x64 and the ADC at 0x48 on I2C bus 1 (the HV must be enabled
+separately).
+"""
+)
+
+if len(sys.argv) > 1 and sys.argv[1] == "hw":
+    dac = i2c_mcp4725(1, 0x64)
+    adc = i2c_ads1115(1, 0x48)
+    reg = hv_regulator(dac, adc, 0, i2c_ads1115.ADS_RANGE_1V, 101)
+else:
+    reg = hv_regulator.simulated()
+
+reg.set_slew(20000)
+for target in [40000, 45000, 35000]:
+    start = time.perf_counter()
+    reg.set_target(target)
+    settled = reg.wait_settled(10)
+    status = reg.status()
+    print(
+        f"Target {target/1000:.1f}V: settled={settled} in {status.settle_time:.3f}s",
+        f"(waited {time.perf_counter()-start:.3f}s),",
+        f"readout {status.measured/1000:.3f}V, error RMS {status.error_rms:.1f}mV,",
+        f"DAC {status.dac:.0f}",
+    )
+    time.sleep(0.5)
+
+reg.stop()
+print("Loop iterations:", reg.status().iterations, "Errors:", reg.status().errors)
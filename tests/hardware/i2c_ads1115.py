@@ -1,4 +1,5 @@
 import logging
+import time
 from modules.i2c_ads1115 import i2c_ads1115
 
 logging.basicConfig(level=20)
@@ -9,6 +10,12 @@ print(
 Expected behavior:
 
 - Prints 4 lines, corresponding to the voltage levels of the 4 input channels.
+- Prints the average read latency of channel 0 for each of the data rate
+  settings, alongside the nominal conversion time.
+- Prints the average of 16 samples of all 4 channels from a single scan, and
+  the scan rate of the raw samples of a single channel.
+- Starts the background sampler on channels 0, 1 and 3, then prints the latest
+  values and the summary of the last 100 samples after 1 second.
 
 Program will then close nominally.
 """
@@ -21,8 +28,45 @@ print("Channel", 1, f"{c1.read_mv(1, i2c_ads1115.ADS_RANGE_4V):7.1f}", "[mV]")
 print("Channel", 2, f"{c1.read_mv(2, i2c_ads1115.ADS_RANGE_4V):7.1f}", "[mV]")
 print("Channel", 3, f"{c1.read_mv(3, i2c_ads1115.ADS_RANGE_4V):7.1f}", "[mV]")
 
+# Read latency at each data rate
+for rate_name in ["8SPS", "64SPS", "128SPS", "250SPS", "475SPS", "860SPS"]:
+    rate = getattr(i2c_ads1115, "ADS_RATE_" + rate_name)
+    n_read = 20
+    start = time.perf_counter()
+    for _ in range(n_read):
+        c1.read_mv(0, i2c_ads1115.ADS_RANGE_4V, rate)
+    latency = (time.perf_counter() - start) / n_read * 1000
+    nominal = i2c_ads1115.conversion_us(rate) / 1000
+    print(f"{rate_name:>7s}: {latency:6.2f} ms/read (conversion {nominal:.2f} ms)")
+
+# Multi-channel scans
+print(
+    "Scan averages [mV]:",
+    c1.scan(
+        [0, 1, 2, 3], i2c_ads1115.ADS_RANGE_4V, i2c_ads1115.ADS_RATE_860SPS, 16
+    ),
+)
+start = time.perf_counter()
+samples = c1.scan(
+    [0], i2c_ads1115.ADS_RANGE_4V, i2c_ads1115.ADS_RATE_860SPS, 500, average=False
+)
+rate = samples.size / (time.perf_counter() - start)
+print(f"Raw scan of shape {samples.shape}: {rate:.0f} samples/s")
+
 # c2 = i2c_ads1115(1, 0x4A)
 # print("Channel", 0, f"{c2.read_mv(0, i2c_ads1115.ADS_RANGE_6V):7.1f}", "[mV]")
 # print("Channel", 1, f"{c2.read_mv(1, i2c_ads1115.ADS_RANGE_6V):7.1f}", "[mV]")
 # print("Channel", 2, f"{c2.read_mv(2, i2c_ads1115.ADS_RANGE_6V):7.1f}", "[mV]")
 # print("Channel", 3, f"{c2.read_mv(3, i2c_ads1115.ADS_RANGE_6V):7.1f}", "[mV]")
+
+# Background sampler
+c1.start_sampler([0, 1, 3], [i2c_ads1115.ADS_RANGE_4V] * 3)
+time.sleep(1)
+for channel in [0, 1, 3]:
+    stats = c1.summary(channel, 100)
+    print(
+        f"Channel {channel}: latest {c1.latest(channel):7.1f} [mV],",
+        f"last {stats.n} samples {stats.mean:7.1f} +- {stats.stddev:.1f} [mV]",
+        f"({stats.min:.1f} - {stats.max:.1f})",
+    )
+c1.stop_sampler()
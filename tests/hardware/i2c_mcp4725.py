@@ -8,7 +8,8 @@ logger = logging.getLogger("GantryMQ")
 print(
     """
 For the next 10 seconds, this will set the output voltage to ~4/5 of the working
-voltage (5V)
+voltage (5V). The output will then be ramped down to 0 over 1 second, and
+ramped back up as fast as the bus allows.
 """
 )
 
@@ -22,6 +23,13 @@ for i in range(11):
     print(c1.read_int())
     time.sleep(5)
 
+# Ramping the output voltage down over 1 second, with 1ms steps, then as fast as
+# the bus allows
+start = c1.read_int()
+values = [start - (start * i) // 999 for i in range(1000)]
+print(f"Ramp with 1 ms steps: {c1.ramp(values, 1000):.3f} s")
+print(f"Ramp as fast as possible: {c1.ramp(values[::-1], 0):.3f} s")
+print("Final value", c1.read_int())
 
 
 # c2 = i2c_ads1115(1, 0x4A)
@@ -0,0 +1,209 @@
+import argparse
+import collections
+import os
+import random
+import re
+import select
+import sys
+import time
+import tty
+
+
+class MarlinSim:
+    """
+    Minimal emulation of the Marlin serial protocol. Received commands are
+    processed in order, motion commands are placed into a planner buffer of
+    fixed size and executed one after another at the configured feed rate. The
+    acknowledgement of a command is only sent once the command is processed,
+    so a full planner will delay the acknowledgement of further motion commands
+    the same way the firmware does.
+    """
+
+    def __init__(self, planner_size: int = 16, error_rate: float = 0.0):
+        self.master, self.slave = os.openpty()
+        tty.setraw(self.master)
+        self.planner_size = planner_size
+        self.error_rate = error_rate
+        self.feed = 1000.0  # mm/s
+        self.pos = [0.0, 0.0, 0.0]  # Position at start of the current move
+        self.planner = collections.deque()  # Target positions of queued moves
+        self.move_start = time.monotonic()
+        self.move_time = 0.0
+        self.commands = collections.deque()  # Received, unprocessed commands
+        self.last_line = 0
+        self.rx = b""
+        self.report_interval = 0.0  # Position auto-report (M154), 0 to disable
+        self.report_next = 0.0
+        self.dwell_end = None  # End time of the currently processed G4 command
+
+    @property
+    def path(self) -> str:
+        return os.ttyname(self.slave)
+
+    def send(self, msg: str):
+        os.write(self.master, (msg + "\n").encode())
+
+    # Motion emulation
+    def update_motion(self):
+        while self.planner:
+            elapsed = time.monotonic() - self.move_start
+            if elapsed < self.move_time:
+                return
+            self.pos = self.planner.popleft()
+            self.move_start += self.move_time
+            self.move_time = self.move_duration(self.pos, self.planner)
+
+    def move_duration(self, start, planner) -> float:
+        if not planner:
+            return 0.0
+        dist = sum((t - p) ** 2 for p, t in zip(start, planner[0])) ** 0.5
+        return dist / self.feed
+
+    def current(self):
+        self.update_motion()
+        if not self.planner or self.move_time == 0:
+            return list(self.pos)
+        frac = min(1.0, (time.monotonic() - self.move_start) / self.move_time)
+        return [p + (t - p) * frac for p, t in zip(self.pos, self.planner[0])]
+
+    def report_position(self):
+        x, y, z = self.current()
+        self.send(
+            f"X:{x:.2f} Y:{y:.2f} Z:{z:.2f} E:0.00 Count X:{x:.2f} Y:{y:.2f} Z:{z:.2f}"
+        )
+
+    def auto_report(self):
+        """Unprompted position report, only containing the projected position"""
+        if not self.report_interval or time.monotonic() < self.report_next:
+            return
+        self.report_next += self.report_interval
+        x, y, z = self.current()
+        self.send(f"X:{x:.2f} Y:{y:.2f} Z:{z:.2f} E:0.00")
+
+    def queue_move(self, cmd: str):
+        val = {k: float(v) for k, v in re.findall(r"([XYZF])([-\d.]+)", cmd)}
+        if "F" in val:
+            self.feed = val["F"] / 60.0
+        target = list(self.planner[-1]) if self.planner else list(self.pos)
+        for i, axis in enumerate("XYZ"):
+            if axis in val:
+                target[i] = val[axis]
+        if not self.planner:
+            self.move_start = time.monotonic()
+        self.planner.append(target)
+        if len(self.planner) == 1:
+            self.move_time = self.move_duration(self.pos, self.planner)
+
+    # Command processing
+    def check_line(self, line: str):
+        """
+        Stripping the line number and checksum, returns None if a resend
+        should be requested.
+        """
+        match = re.match(r"N(\d+) (.*)\*(\d+)$", line)
+        if not match:
+            return line
+        number, cmd = int(match.group(1)), match.group(2)
+        checksum = 0
+        for c in line[: line.rindex("*")].encode():
+            checksum ^= c
+        if checksum != int(match.group(3)) or random.random() < self.error_rate:
+            self.send(f"Error:checksum mismatch, Last Line: {self.last_line}")
+        elif number != self.last_line + 1 and not cmd.startswith("M110"):
+            self.send(
+                "Error:Line Number is not Last Line Number+1, Last Line: "
+                + str(self.last_line)
+            )
+        else:
+            self.last_line = number
+            return cmd
+        self.send(f"Resend: {self.last_line + 1}")
+        self.send("ok")
+        return None
+
+    def run_command(self, cmd: str) -> bool:
+        """Returns False if the command cannot be processed yet"""
+        word = cmd.split()[0] if cmd else ""
+        if word in ("G0", "G1"):
+            self.update_motion()
+            if len(self.planner) >= self.planner_size:
+                return False
+            self.queue_move(cmd)
+        elif word == "G4":
+            self.update_motion()
+            if self.planner:
+                return False
+            if self.dwell_end is None:
+                match = re.search(r"P(\d+)", cmd)
+                self.dwell_end = time.monotonic() + int(match.group(1)) / 1000
+            if time.monotonic() < self.dwell_end:
+                return False
+            self.dwell_end = None
+        elif word == "G28":
+            self.pos, self.move_time = [0.0] * 3, 0.0
+            self.planner.clear()
+        elif word == "M110":
+            match = re.search(r"N(\d+)", cmd)
+            self.last_line = int(match.group(1)) if match else 0
+        elif word == "M114":
+            self.report_position()
+        elif word == "M154":
+            match = re.search(r"S([\d.]+)", cmd)
+            self.report_interval = float(match.group(1)) if match else 0.0
+            self.report_next = time.monotonic() + self.report_interval
+        elif word == "M400":
+            self.update_motion()
+            if self.planner:
+                return False
+        elif word == "M503":
+            self.send("echo:  M200 D1.75")
+            self.send("echo:  M203 X1000.00 Y1000.00 Z1000.00")
+        self.send("ok")
+        return True
+
+    def process(self):
+        while self.commands and self.run_command(self.commands[0]):
+            self.commands.popleft()
+
+    def handle_input(self, data: bytes):
+        self.rx += data
+        while b"\n" in self.rx:
+            line, self.rx = self.rx.split(b"\n", 1)
+            cmd = self.check_line(line.decode().strip())
+            if cmd is not None:
+                self.commands.append(cmd)
+
+    def run(self):
+        print("Emulated serial port:", self.path, flush=True)
+        while True:
+            ready, _, _ = select.select([self.master], [], [], 0.001)
+            if ready:
+                self.handle_input(os.read(self.master, 4096))
+            self.process()
+            self.auto_report()
+
+
+if __name__ == "__main__":
+    print(
+        """
+Pseudo-terminal stand-in for a Marlin printer, used for testing the gcoder
+interface without a gantry attached. The path to the emulated serial port is
+printed on start up, pass this path to the gcoder tests in place of
+/dev/ttyUSB0. Motion commands are emulated at the configured feed rate.
+
+Program runs until interrupted.
+"""
+    )
+    parser = argparse.ArgumentParser("marlin_sim.py")
+    parser.add_argument("--planner", type=int, default=16, help="Planner size")
+    parser.add_argument(
+        "--error-rate",
+        type=float,
+        default=0.0,
+        help="Fraction of numbered lines to reject as corrupted",
+    )
+    args = parser.parse_args()
+    try:
+        MarlinSim(planner_size=args.planner, error_rate=args.error_rate).run()
+    except KeyboardInterrupt:
+        sys.exit(0)
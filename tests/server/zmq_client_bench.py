@@ -0,0 +1,134 @@
+import argparse
+import asyncio
+import inspect
+import logging
+import threading
+import time
+
+from gmqclient.zmq_client import (
+    HWAsyncControlClient,
+    HWClientInstance,
+    HWControlClient,
+    make_zmq_async_client_socket,
+    make_zmq_client_socket,
+)
+from gmqclient.server.zmq_server import (
+    HWBaseInstance,
+    HWControlServer,
+    make_zmq_server_socket,
+)
+
+parser = argparse.ArgumentParser(
+    "zmq_client_bench.py", "Benchmark of the client call rates with a dummy server"
+)
+parser.add_argument("--port", type=int, default=8990, help="Port to use for server")
+parser.add_argument("--n", type=int, default=5000, help="Number of calls to time")
+parser.add_argument("--depth", type=int, default=20, help="Call stack depth")
+args = parser.parse_args()
+
+print(
+    f"""
+Expected behavior:
+
+- The overhead of identifying the method name in the client is timed without a
+  server, with the call made {args.depth} frames deep in the call stack, for the
+  previous call stack inspection and the current method lookup.
+- A server with a dummy ADC is started on port {args.port}, and the rate of
+  telemetry calls is printed for sequential calls, for the asynchronous client
+  with 1, 16 and 64 outstanding calls, and for batches of 16 and 64 calls.
+"""
+)
+
+
+class DummyADC(HWBaseInstance):
+    def read_mv(self) -> float:
+        return 1.0
+
+    def is_initialized(self) -> bool:
+        return True
+
+    @property
+    def telemetry_methods(self):
+        return ["read_mv"]
+
+
+class ADCClient(HWClientInstance):
+    def read_mv(self) -> float:
+        return self._wrap_method()
+
+
+class InspectADCClient(ADCClient):
+    """Previous method name lookup, inspecting the full call stack"""
+
+    def _wrap_method(self, *args, **kwargs):
+        return self.client.run_function(
+            self.name, inspect.stack()[1][3], *args, **kwargs
+        )
+
+
+class NullClient(object):
+    def run_function(self, hw_name: str, function_name: str, *args, **kwargs):
+        return function_name
+
+
+def at_depth(depth: int, f):
+    return at_depth(depth - 1, f) if depth > 0 else f()
+
+
+def print_rate(label: str, n: int, start: float):
+    print(f"{label:>32s}: {n / (time.perf_counter() - start):10.0f} calls/s")
+
+
+## Method name lookup overhead
+for cls in [InspectADCClient, ADCClient]:
+    adc = cls("adc")
+    adc.client = NullClient()
+    start = time.perf_counter()
+    for _ in range(args.n):
+        assert at_depth(args.depth, adc.read_mv) == "read_mv"
+    print_rate(f"{cls.__name__} (no server)", args.n, start)
+
+## Call rates with the server
+logger = logging.getLogger("ClientBench")
+logger.setLevel(logging.WARNING)
+server = HWControlServer(
+    socket=make_zmq_server_socket(args.port),
+    logger=logger,
+    hw_list=[DummyADC("adc", logger)],
+)
+threading.Thread(target=server.run_server, daemon=True).start()
+
+for cls in [InspectADCClient, ADCClient]:
+    client = HWControlClient(
+        make_zmq_client_socket("localhost", args.port), logger, [cls("adc")]
+    )
+    start = time.perf_counter()
+    for _ in range(args.n):
+        client.hw_list[0].read_mv()
+    print_rate(f"{cls.__name__} (sequential)", args.n, start)
+
+for size in [16, 64]:
+    start = time.perf_counter()
+    for _ in range(args.n // size):
+        with client.batch():
+            for _ in range(size):
+                client.hw_list[0].read_mv()
+    print_rate(f"Batch of {size}", args.n // size * size, start)
+client.close()
+
+
+async def run_async():
+    socket = make_zmq_async_client_socket("localhost", args.port)
+    client = HWAsyncControlClient(socket, logger, [ADCClient("adc")])
+    for outstanding in [1, 16, 64]:
+        n = args.n // outstanding
+        start = time.perf_counter()
+        for _ in range(n):
+            await asyncio.gather(
+                *[client.hw_list[0].read_mv() for _ in range(outstanding)]
+            )
+        print_rate(f"Async ({outstanding} outstanding)", n * outstanding, start)
+    await client.close()
+
+
+asyncio.run(run_async())
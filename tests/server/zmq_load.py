@@ -0,0 +1,138 @@
+import argparse
+import logging
+import threading
+import time
+
+import numpy
+import zmq
+import zmq_wire
+from zmq_server import HWBaseInstance, HWControlServer, make_zmq_server_socket
+
+parser = argparse.ArgumentParser(
+    "zmq_load.py", "Load test of the ZMQ server with dummy hardware instances"
+)
+parser.add_argument("--port", type=int, default=8990, help="Port to use for server")
+parser.add_argument("--n", type=int, default=2000, help="Telemetry calls to time")
+parser.add_argument("--home", type=float, default=0.5, help="Homing time [s]")
+args = parser.parse_args()
+
+print(
+    f"""
+Expected behavior:
+
+- A server with a dummy gantry and a dummy ADC is started on port {args.port}.
+- The latency of {args.n} ADC telemetry calls is measured without load, then
+  while a second client continuously calls a {args.home}s homing operation on
+  the gantry. The ADC latency should not be affected by the homing calls.
+- Telemetry calls to the gantry itself are then timed under the same load,
+  these are expected to wait for the homing calls, as calls to the same device
+  are serialized.
+"""
+)
+
+
+class DummyGantry(HWBaseInstance):
+    def home(self, duration: float) -> None:
+        time.sleep(duration)
+
+    def get_position(self) -> float:
+        return 0.0
+
+    def is_initialized(self) -> bool:
+        return True
+
+    @property
+    def telemetry_methods(self):
+        return ["get_position"]
+
+    @property
+    def operation_methods(self):
+        return ["home"]
+
+
+class DummyADC(HWBaseInstance):
+    def read_mv(self) -> float:
+        return 1.0
+
+    def is_initialized(self) -> bool:
+        return True
+
+    @property
+    def telemetry_methods(self):
+        return ["read_mv"]
+
+
+logger = logging.getLogger("LoadTest")
+logger.setLevel(logging.WARNING)
+server = HWControlServer(
+    socket=make_zmq_server_socket(args.port),
+    logger=logger,
+    hw_list=[DummyGantry("gantry", logger), DummyADC("adc", logger)],
+)
+threading.Thread(target=server.run_server, daemon=True).start()
+
+
+def make_caller(client_id: str):
+    socket = zmq.Context.instance().socket(zmq.REQ)
+    socket.connect(f"tcp://localhost:{args.port}")
+
+    def call(hw_name: str, function_name: str, *f_args):
+        zmq_wire.send(
+            socket,
+            dict(
+                client_id=client_id,
+                hw_name=hw_name,
+                function_name=function_name,
+                args=f_args,
+                kwargs={},
+            ),
+        )
+        response = zmq_wire.recv(socket)
+        if "exception" in response:
+            raise response["exception"]
+        return response["return"]
+
+    return call
+
+
+def time_telemetry(hw_name: str, function_name: str, n: int) -> numpy.ndarray:
+    call = make_caller("telemetry")
+    latency = []
+    for _ in range(n):
+        start = time.perf_counter()
+        call(hw_name, function_name)
+        latency.append(time.perf_counter() - start)
+    return numpy.array(latency) * 1e3
+
+
+def print_latency(label: str, latency: numpy.ndarray):
+    print(
+        f"{label:>32s}:",
+        f"p50={numpy.percentile(latency, 50):.3f}ms",
+        f"p99={numpy.percentile(latency, 99):.3f}ms",
+        f"max={numpy.max(latency):.3f}ms",
+    )
+
+
+print_latency("ADC telemetry (no load)", time_telemetry("adc", "read_mv", args.n))
+
+stop = threading.Event()
+
+
+def operation_load():
+    call = make_caller("operator")
+    call("", "claim_operator")
+    while not stop.is_set():
+        call("gantry", "home", args.home)
+
+
+load_thread = threading.Thread(target=operation_load)
+load_thread.start()
+time.sleep(0.1)
+print_latency("ADC telemetry (gantry homing)", time_telemetry("adc", "read_mv", args.n))
+print_latency(
+    "Gantry telemetry (gantry homing)",
+    time_telemetry("gantry", "get_position", max(10, int(5 / args.home))),
+)
+stop.set()
+load_thread.join()